@@ -12,13 +12,18 @@
 #include "Writer.h"
 #include "SymbolTable.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/BinaryFormat/COFF.h"
 #include "llvm/Object/COFF.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
+#include <tuple>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -752,6 +757,16 @@ void LocalImportChunk::writeTo(uint8_t *buf) const {
   }
 }
 
+void uniqueRVASet(SymbolRVASet &rvaSet) {
+  parallelSort(rvaSet, [](const ChunkAndOffset &a, const ChunkAndOffset &b) {
+    return std::tie(a.inputChunk, a.offset) < std::tie(b.inputChunk, b.offset);
+  });
+  auto eq = [](const ChunkAndOffset &a, const ChunkAndOffset &b) {
+    return a.inputChunk == b.inputChunk && a.offset == b.offset;
+  };
+  rvaSet.erase(std::unique(rvaSet.begin(), rvaSet.end(), eq), rvaSet.end());
+}
+
 void RVATableChunk::writeTo(uint8_t *buf) const {
   ulittle32_t *begin = reinterpret_cast<ulittle32_t *>(buf);
   size_t cnt = 0;
@@ -829,22 +844,47 @@ void PseudoRelocTableChunk::writeTo(uint8_t *buf) const {
 //
 // Usually we have a lot of relocations for each page, so the number of
 // bytes for one .reloc entry is close to 2 bytes on average.
-BaserelChunk::BaserelChunk(uint32_t page, Baserel *begin, Baserel *end) {
+BaserelChunk::BaserelChunk(StringRef secName, std::vector<Baserel> v)
+    : secName(secName), relocs(std::move(v)) {
+  // Find where the page changes in parallel.
+  const uint32_t mask = ~uint32_t(pageSize - 1);
+  const size_t numShards = 64;
+  std::vector<std::vector<uint32_t>> starts(numShards);
+  parallelForEachN(0, numShards, [&](size_t shard) {
+    size_t begin = relocs.size() * shard / numShards;
+    size_t end = relocs.size() * (shard + 1) / numShards;
+    for (size_t i = begin; i < end; ++i)
+      if (i == 0 || (relocs[i].rva & mask) != (relocs[i - 1].rva & mask))
+        starts[shard].push_back(i);
+  });
+
   // Block header consists of 4 byte page RVA and 4 byte block size.
   // Each entry is 2 byte. Last entry may be padding.
-  data.resize(alignTo((end - begin) * 2 + 8, 4));
-  uint8_t *p = data.data();
-  write32le(p, page);
-  write32le(p + 4, data.size());
-  p += 8;
-  for (Baserel *i = begin; i != end; ++i) {
-    write16le(p, (i->type << 12) | (i->rva - page));
-    p += 2;
+  for (ArrayRef<uint32_t> v : starts)
+    for (uint32_t i : v)
+      blocks.push_back({relocs[i].rva & mask, i, 0, 0});
+  for (size_t i = 0, e = blocks.size(); i < e; ++i) {
+    Block &b = blocks[i];
+    b.end = (i + 1 < e) ? blocks[i + 1].begin : relocs.size();
+    b.offset = size;
+    size += alignTo((b.end - b.begin) * 2 + 8, 4);
   }
 }
 
 void BaserelChunk::writeTo(uint8_t *buf) const {
-  memcpy(buf, data.data(), data.size());
+  parallelForEach(blocks, [&](const Block &b) {
+    uint8_t *p = buf + b.offset;
+    uint32_t blockSize = alignTo((b.end - b.begin) * 2 + 8, 4);
+    write32le(p, b.page);
+    write32le(p + 4, blockSize);
+    p += 8;
+    for (uint32_t i = b.begin; i != b.end; ++i) {
+      write16le(p, (relocs[i].type << 12) | (relocs[i].rva - b.page));
+      p += 2;
+    }
+    if ((b.end - b.begin) % 2)
+      write16le(p, 0);
+  });
 }
 
 uint8_t Baserel::getDefaultType() {
@@ -862,10 +902,7 @@ uint8_t Baserel::getDefaultType() {
 
 MergeChunk *MergeChunk::instances[Log2MaxSectionAlignment + 1] = {};
 
-MergeChunk::MergeChunk(uint32_t alignment)
-    : builder(StringTableBuilder::RAW, alignment) {
-  setAlignment(alignment);
-}
+MergeChunk::MergeChunk(uint32_t alignment) { setAlignment(alignment); }
 
 void MergeChunk::addSection(SectionChunk *c) {
   assert(isPowerOf2_32(c->getAlignment()));
@@ -877,34 +914,104 @@ void MergeChunk::addSection(SectionChunk *c) {
   mc->sections.push_back(c);
 }
 
+// Returns true if A sorts before B when comparing the strings from their last
+// characters. A string sorts after the strings it is a tail of.
+static bool tailGreater(StringRef a, StringRef b) {
+  size_t n = std::min(a.size(), b.size());
+  for (size_t i = 1; i <= n; ++i) {
+    unsigned char ca = a[a.size() - i];
+    unsigned char cb = b[b.size() - i];
+    if (ca != cb)
+      return ca > cb;
+  }
+  return a.size() > b.size();
+}
+
 void MergeChunk::finalizeContents() {
   assert(!finalized && "should only finalize once");
-  for (SectionChunk *c : sections)
-    if (c->live)
-      builder.add(toStringRef(c->getContents()));
-  builder.finalize();
+
+  std::vector<uint64_t> hashes(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    if (sections[i]->live)
+      hashes[i] = xxHash64(sections[i]->getContents());
+  });
+
+  // Deduplicate the contents in shards selected by their hashes, so that each
+  // shard can be processed by a separate thread. Until the shards are
+  // concatenated, sectionStrings holds indices into the shard's strings.
+  const size_t numShards = 32;
+  std::vector<StringRef> shardStrings[numShards];
+  sectionStrings.assign(sections.size(), 0);
+  parallelForEachN(0, numShards, [&](size_t shard) {
+    DenseMap<CachedHashStringRef, uint32_t> map;
+    for (size_t i = 0, e = sections.size(); i != e; ++i) {
+      if (!sections[i]->live || hashes[i] % numShards != shard)
+        continue;
+      StringRef s = toStringRef(sections[i]->getContents());
+      auto p = map.insert(
+          {CachedHashStringRef(s, hashes[i]), shardStrings[shard].size()});
+      if (p.second)
+        shardStrings[shard].push_back(s);
+      sectionStrings[i] = p.first->second;
+    }
+  });
+
+  size_t shardBegin[numShards];
+  for (size_t shard = 0; shard < numShards; ++shard) {
+    shardBegin[shard] = strings.size();
+    strings.insert(strings.end(), shardStrings[shard].begin(),
+                   shardStrings[shard].end());
+  }
+  for (size_t i = 0, e = sections.size(); i != e; ++i)
+    if (sections[i]->live)
+      sectionStrings[i] += shardBegin[hashes[i] % numShards];
+
+  // Sort the strings so that each string directly follows the strings it is a
+  // tail of, and place it in the previous string if the alignment allows.
+  std::vector<uint32_t> order(strings.size());
+  for (uint32_t i = 0, e = order.size(); i != e; ++i)
+    order[i] = i;
+  parallelSort(order, [&](uint32_t a, uint32_t b) {
+    return tailGreater(strings[a], strings[b]);
+  });
+
+  offsets.resize(strings.size());
+  uint32_t alignment = getAlignment();
+  StringRef prev;
+  for (uint32_t i : order) {
+    StringRef s = strings[i];
+    if (prev.endswith(s)) {
+      size_t pos = size - s.size();
+      if (!(pos & (alignment - 1))) {
+        offsets[i] = pos;
+        continue;
+      }
+    }
+    size = alignTo(size, alignment);
+    offsets[i] = size;
+    size += s.size();
+    roots.push_back(i);
+    prev = s;
+  }
   finalized = true;
 }
 
 void MergeChunk::assignSubsectionRVAs() {
-  for (SectionChunk *c : sections) {
-    if (!c->live)
-      continue;
-    size_t off = builder.getOffset(toStringRef(c->getContents()));
-    c->setRVA(rva + off);
-  }
+  for (size_t i = 0, e = sections.size(); i != e; ++i)
+    if (sections[i]->live)
+      sections[i]->setRVA(rva + offsets[sectionStrings[i]]);
 }
 
 uint32_t MergeChunk::getOutputCharacteristics() const {
   return IMAGE_SCN_MEM_READ | IMAGE_SCN_CNT_INITIALIZED_DATA;
 }
 
-size_t MergeChunk::getSize() const {
-  return builder.getSize();
-}
+size_t MergeChunk::getSize() const { return size; }
 
 void MergeChunk::writeTo(uint8_t *buf) const {
-  builder.write(buf);
+  parallelForEach(roots, [&](uint32_t i) {
+    memcpy(buf + offsets[i], strings[i].data(), strings[i].size());
+  });
 }
 
 // MinGW specific.
@@ -16,8 +16,8 @@
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/iterator.h"
 #include "llvm/ADT/iterator_range.h"
-#include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Object/COFF.h"
+#include <atomic>
 #include <utility>
 #include <vector>
 
@@ -314,8 +314,9 @@ public:
   // Auxiliary Format 5: Section Definitions. Used for ICF.
   uint32_t checksum = 0;
 
-  // Used by the garbage collector.
-  bool live;
+  // Used by the garbage collector. This is atomic because the collector may
+  // mark sections from several threads.
+  std::atomic<bool> live;
 
   // Whether this section needs to be kept distinct from other sections during
   // ICF. This is set by the driver using address-significance tables.
@@ -398,9 +399,9 @@ inline StringRef Chunk::getDebugName() const {
 //
 // If string tail merging is enabled and a section is identified as containing a
 // string literal, it is added to a MergeChunk with an appropriate alignment.
-// The MergeChunk then tail merges the strings using the StringTableBuilder
-// class and assigns RVAs and section offsets to each of the member chunks based
-// on the offsets assigned by the StringTableBuilder.
+// The MergeChunk then deduplicates and tail merges the strings and assigns RVAs
+// and section offsets to each of the member chunks based on the offsets
+// assigned to their strings. The layout is the same as StringTableBuilder's.
 class MergeChunk : public NonSectionChunk {
 public:
   MergeChunk(uint32_t alignment);
@@ -417,7 +418,17 @@ public:
   std::vector<SectionChunk *> sections;
 
 private:
-  llvm::StringTableBuilder builder;
+  // The unique contents of the live sections and their offsets in this chunk.
+  std::vector<StringRef> strings;
+  std::vector<uint32_t> offsets;
+
+  // The strings that are not a tail of another string and need to be written.
+  std::vector<uint32_t> roots;
+
+  // The index in strings of the contents of each of the sections.
+  std::vector<uint32_t> sectionStrings;
+
+  size_t size = 0;
   bool finalized = false;
 };
 
@@ -542,25 +553,13 @@ private:
 struct ChunkAndOffset {
   Chunk *inputChunk;
   uint32_t offset;
-
-  struct DenseMapInfo {
-    static ChunkAndOffset getEmptyKey() {
-      return {llvm::DenseMapInfo<Chunk *>::getEmptyKey(), 0};
-    }
-    static ChunkAndOffset getTombstoneKey() {
-      return {llvm::DenseMapInfo<Chunk *>::getTombstoneKey(), 0};
-    }
-    static unsigned getHashValue(const ChunkAndOffset &co) {
-      return llvm::DenseMapInfo<std::pair<Chunk *, uint32_t>>::getHashValue(
-          {co.inputChunk, co.offset});
-    }
-    static bool isEqual(const ChunkAndOffset &lhs, const ChunkAndOffset &rhs) {
-      return lhs.inputChunk == rhs.inputChunk && lhs.offset == rhs.offset;
-    }
-  };
 };
 
-using SymbolRVASet = llvm::DenseSet<ChunkAndOffset>;
+// The symbols of an RVA table. The list is built from per-object lists in
+// parallel and must be uniqued with uniqueRVASet before it is used.
+using SymbolRVASet = std::vector<ChunkAndOffset>;
+
+void uniqueRVASet(SymbolRVASet &rvaSet);
 
 // Table which contains symbol RVAs. Used for /safeseh and /guard:cf.
 class RVATableChunk : public NonSectionChunk {
@@ -573,19 +572,6 @@ private:
   SymbolRVASet syms;
 };
 
-// Windows-specific.
-// This class represents a block in .reloc section.
-// See the PE/COFF spec 5.6 for details.
-class BaserelChunk : public NonSectionChunk {
-public:
-  BaserelChunk(uint32_t page, Baserel *begin, Baserel *end);
-  size_t getSize() const override { return data.size(); }
-  void writeTo(uint8_t *buf) const override;
-
-private:
-  std::vector<uint8_t> data;
-};
-
 class Baserel {
 public:
   Baserel(uint32_t v, uint8_t ty) : rva(v), type(ty) {}
@@ -596,6 +582,31 @@ public:
   uint8_t type;
 };
 
+// Windows-specific.
+// This class represents the blocks in .reloc section for the base relocations
+// of one output section. There is one block for each run of relocations in
+// the same page. See the PE/COFF spec 5.6 for details.
+class BaserelChunk : public NonSectionChunk {
+public:
+  BaserelChunk(StringRef secName, std::vector<Baserel> relocs);
+  size_t getSize() const override { return size; }
+  void writeTo(uint8_t *buf) const override;
+
+  struct Block {
+    uint32_t page;
+    uint32_t begin; // index of the first relocation in relocs
+    uint32_t end;
+    uint32_t offset; // offset of the block in this chunk
+  };
+
+  StringRef secName;
+  std::vector<Baserel> relocs;
+  std::vector<Block> blocks;
+
+private:
+  size_t size = 0;
+};
+
 // This is a placeholder Chunk, to allow attaching a DefinedSynthetic to a
 // specific place in a section, without any data. This is used for the MinGW
 // specific symbol __RUNTIME_PSEUDO_RELOC_LIST_END__, even though the concept
@@ -677,10 +688,4 @@ void applyArm64Branch26(uint8_t *off, int64_t v);
 } // namespace coff
 } // namespace lld
 
-namespace llvm {
-template <>
-struct DenseMapInfo<lld::coff::ChunkAndOffset>
-    : lld::coff::ChunkAndOffset::DenseMapInfo {};
-}
-
 #endif
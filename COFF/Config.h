@@ -103,6 +103,7 @@ struct Configuration {
   bool debugDwarf = false;
   bool debugGHashes = false;
   bool debugSymtab = false;
+  bool buildIdHash128 = false;
   bool showTiming = false;
   bool showSummary = false;
   unsigned debugTypes = static_cast<unsigned>(DebugType::None);
@@ -110,6 +111,7 @@ struct Configuration {
   llvm::SmallString<128> pdbAltPath;
   llvm::SmallString<128> pdbPath;
   llvm::SmallString<128> pdbSourcePath;
+  std::string pdbTypeCacheDir;
   std::vector<llvm::StringRef> argv;
 
   // Symbols in this set are considered as live by the garbage collector.
@@ -179,6 +181,7 @@ struct Configuration {
 
   // Used for /lldmap.
   std::string mapFile;
+  std::string baserelStatsFile;
 
   // Used for /thinlto-index-only:
   llvm::StringRef thinLTOIndexOnlyArg;
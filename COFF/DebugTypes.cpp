@@ -7,15 +7,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "DebugTypes.h"
+#include "Config.h"
 #include "Driver.h"
 #include "InputFiles.h"
 #include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/DebugInfo/CodeView/GUID.h"
 #include "llvm/DebugInfo/CodeView/TypeRecord.h"
 #include "llvm/DebugInfo/PDB/GenericError.h"
 #include "llvm/DebugInfo/PDB/Native/InfoStream.h"
 #include "llvm/DebugInfo/PDB/Native/NativeSession.h"
 #include "llvm/DebugInfo/PDB/Native/PDBFile.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
 
 using namespace lld;
 using namespace lld::coff;
@@ -266,3 +272,123 @@ Expected<TypeServerSource *> TypeServerSource::getInstance(MemoryBufferRef m) {
     return info.takeError();
   return new TypeServerSource(m, session.release());
 }
+
+namespace {
+// The header of a /pdbtypecache file. It is followed by the global hashes of
+// the TPI records and then by those of the IPI records.
+struct GHashCacheHeader {
+  char magic[8];
+  support::ulittle32_t version;
+  support::ulittle32_t numTypes;
+  support::ulittle32_t numIds;
+  support::ulittle64_t contentHash;
+};
+} // namespace
+
+static const char ghashCacheMagic[] = "LLDGHASH";
+
+// Bump this if the layout or the hash function changes.
+static const uint32_t ghashCacheVersion = 2;
+
+static std::string getGHashCachePath(StringRef key) {
+  SmallString<128> path(config->pdbTypeCacheDir);
+  sys::path::append(path, key + ".ghash");
+  return path.str();
+}
+
+std::string lld::coff::getTypeServerCacheKey(const codeview::GUID &guid,
+                                             uint32_t age) {
+  return ("pdb-" + toHex(makeArrayRef(guid.Guid)) + "-" + Twine(age)).str();
+}
+
+std::string lld::coff::getPrecompCacheKey(uint32_t signature) {
+  return "pch-" + utohexstr(signature);
+}
+
+uint64_t lld::coff::getGHashCacheContentHash(const CVTypeArray &types,
+                                             const CVTypeArray *ids) {
+  // Records of a PDB stream may not be contiguous in memory, so hash them one
+  // by one and then hash the list of record hashes.
+  std::vector<support::ulittle64_t> recordHashes;
+  for (const CVType &ty : types)
+    recordHashes.push_back(xxHash64(toStringRef(ty.RecordData)));
+  if (ids)
+    for (const CVType &ty : *ids)
+      recordHashes.push_back(xxHash64(toStringRef(ty.RecordData)));
+  return xxHash64(StringRef(reinterpret_cast<const char *>(recordHashes.data()),
+                            recordHashes.size() * sizeof(uint64_t)));
+}
+
+bool lld::coff::readGHashCache(StringRef key, uint32_t numTypes,
+                               uint32_t numIds, uint64_t contentHash,
+                               std::vector<GloballyHashedType> &hashes) {
+  if (config->pdbTypeCacheDir.empty())
+    return false;
+
+  std::string path = getGHashCachePath(key);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(path, -1, false);
+  if (!mbOrErr)
+    return false;
+
+  // A cache entry that does not match the input exactly is ignored and will
+  // be overwritten by writeGHashCache().
+  StringRef data = (*mbOrErr)->getBuffer();
+  uint64_t numHashes = (uint64_t)numTypes + numIds;
+  auto *hdr = reinterpret_cast<const GHashCacheHeader *>(data.data());
+  if (data.size() !=
+          sizeof(GHashCacheHeader) + numHashes * sizeof(GloballyHashedType) ||
+      memcmp(hdr->magic, ghashCacheMagic, sizeof(hdr->magic)) != 0 ||
+      hdr->version != ghashCacheVersion || hdr->numTypes != numTypes ||
+      hdr->numIds != numIds || hdr->contentHash != contentHash) {
+    log("Ignoring stale type hash cache " + path);
+    return false;
+  }
+
+  auto *begin = reinterpret_cast<const GloballyHashedType *>(
+      data.data() + sizeof(GHashCacheHeader));
+  hashes.assign(begin, begin + numHashes);
+  log("Loaded global type hashes from " + path);
+  return true;
+}
+
+void lld::coff::writeGHashCache(StringRef key, uint32_t numTypes,
+                                uint64_t contentHash,
+                                ArrayRef<GloballyHashedType> hashes) {
+  if (config->pdbTypeCacheDir.empty())
+    return;
+
+  if (std::error_code ec =
+          sys::fs::create_directories(config->pdbTypeCacheDir)) {
+    warn("cannot create directory " + config->pdbTypeCacheDir + ": " +
+         ec.message());
+    return;
+  }
+
+  // FileOutputBuffer writes to a temporary file and renames it on commit, so
+  // concurrent links sharing the cache never see a partially written entry.
+  std::string path = getGHashCachePath(key);
+  size_t size =
+      sizeof(GHashCacheHeader) + hashes.size() * sizeof(GloballyHashedType);
+  Expected<std::unique_ptr<FileOutputBuffer>> bufOrErr =
+      FileOutputBuffer::create(path, size);
+  if (!bufOrErr) {
+    warn("cannot write type hash cache " + path + ": " +
+         toString(bufOrErr.takeError()));
+    return;
+  }
+
+  std::unique_ptr<FileOutputBuffer> &buf = *bufOrErr;
+  auto *hdr = reinterpret_cast<GHashCacheHeader *>(buf->getBufferStart());
+  memcpy(hdr->magic, ghashCacheMagic, sizeof(hdr->magic));
+  hdr->version = ghashCacheVersion;
+  hdr->numTypes = numTypes;
+  hdr->numIds = hashes.size() - numTypes;
+  hdr->contentHash = contentHash;
+  memcpy(buf->getBufferStart() + sizeof(GHashCacheHeader), hashes.data(),
+         hashes.size() * sizeof(GloballyHashedType));
+
+  if (Error e = buf->commit())
+    warn("cannot write type hash cache " + path + ": " +
+         toString(std::move(e)));
+}
@@ -9,11 +9,14 @@
 #ifndef LLD_COFF_DEBUGTYPES_H
 #define LLD_COFF_DEBUGTYPES_H
 
+#include "llvm/DebugInfo/CodeView/TypeHashing.h"
+#include "llvm/DebugInfo/CodeView/TypeRecord.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 
 namespace llvm {
 namespace codeview {
+struct GUID;
 class PrecompRecord;
 class TypeServer2Record;
 } // namespace codeview
@@ -54,6 +57,30 @@ template <typename T> const T &retrieveDependencyInfo(const TpiSource *source);
 llvm::Expected<llvm::pdb::NativeSession *>
 findTypeServerSource(const ObjFile *f);
 
+// Global type hashes of type server PDBs and precompiled headers objects are
+// expensive to compute and do not change between links, so they can be cached
+// on disk in the /pdbtypecache directory. Type servers are identified by their
+// GUID and age, and precompiled headers objects by their signature.
+std::string getTypeServerCacheKey(const llvm::codeview::GUID &guid,
+                                  uint32_t age);
+std::string getPrecompCacheKey(uint32_t signature);
+
+// Returns a cheap hash of the type and item records to be cached. It is stored
+// in the cache entry, so that an entry whose key matches but whose records
+// have changed is not used.
+uint64_t getGHashCacheContentHash(const llvm::codeview::CVTypeArray &types,
+                                  const llvm::codeview::CVTypeArray *ids);
+
+// Reads the hashes of numTypes TPI records followed by numIds IPI records.
+// Returns false if there is no usable cache entry.
+bool readGHashCache(llvm::StringRef key, uint32_t numTypes, uint32_t numIds,
+                    uint64_t contentHash,
+                    std::vector<llvm::codeview::GloballyHashedType> &hashes);
+
+void writeGHashCache(llvm::StringRef key, uint32_t numTypes,
+                     uint64_t contentHash,
+                     llvm::ArrayRef<llvm::codeview::GloballyHashedType> hashes);
+
 } // namespace coff
 } // namespace lld
 
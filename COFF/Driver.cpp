@@ -25,6 +25,7 @@
 #include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/BinaryFormat/Magic.h"
 #include "llvm/Object/ArchiveWriter.h"
@@ -146,6 +147,13 @@ static std::future<MBErrPair> createFutureForFile(std::string path) {
   });
 }
 
+// Pre-parses an input file if it is a COFF object file. This is thread-safe.
+static std::unique_ptr<PreParsedObjFile> maybePreParse(MemoryBufferRef mb) {
+  if (identify_magic(mb.getBuffer()) != file_magic::coff_object)
+    return nullptr;
+  return preParseObjFile(mb);
+}
+
 // Symbol names are mangled by prepending "_" on x86.
 static StringRef mangle(StringRef sym) {
   assert(config->machine != IMAGE_FILE_MACHINE_UNKNOWN);
@@ -170,7 +178,8 @@ MemoryBufferRef LinkerDriver::takeBuffer(std::unique_ptr<MemoryBuffer> mb) {
 }
 
 void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> mb,
-                             bool wholeArchive) {
+                             bool wholeArchive,
+                             std::unique_ptr<PreParsedObjFile> preParsed) {
   StringRef filename = mb->getBufferIdentifier();
 
   MemoryBufferRef mbref = takeBuffer(std::move(mb));
@@ -188,8 +197,15 @@ void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> mb,
       Archive *archive = file.get();
       make<std::unique_ptr<Archive>>(std::move(file)); // take ownership
 
-      for (MemoryBufferRef m : getArchiveMembers(archive))
-        addArchiveBuffer(m, "<whole-archive>", filename, 0);
+      std::vector<MemoryBufferRef> members = getArchiveMembers(archive);
+      std::vector<std::unique_ptr<PreParsedObjFile>> preParsedMembers(
+          members.size());
+      parallelForEachN(0, members.size(), [&](size_t i) {
+        preParsedMembers[i] = maybePreParse(members[i]);
+      });
+      for (size_t i = 0; i < members.size(); ++i)
+        addArchiveBuffer(members[i], "<whole-archive>", filename, 0,
+                         std::move(preParsedMembers[i]));
       return;
     }
     symtab->addFile(make<ArchiveFile>(mbref));
@@ -199,7 +215,7 @@ void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> mb,
     break;
   case file_magic::coff_object:
   case file_magic::coff_import_library:
-    symtab->addFile(make<ObjFile>(mbref));
+    symtab->addFile(make<ObjFile>(mbref, std::move(preParsed)));
     break;
   case file_magic::pdb:
     loadTypeServerSource(mbref);
@@ -220,33 +236,51 @@ void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> mb,
   }
 }
 
+namespace {
+// The part of loading an input file that LinkerDriver::run() does in
+// parallel: reading the file and pre-parsing it if it is an object file.
+struct PreparedInput {
+  MBErrPair mbOrErr;
+  std::unique_ptr<PreParsedObjFile> obj;
+};
+} // namespace
+
 void LinkerDriver::enqueuePath(StringRef path, bool wholeArchive) {
   auto future =
       std::make_shared<std::future<MBErrPair>>(createFutureForFile(path));
+  auto input = std::make_shared<PreparedInput>();
   std::string pathStr = path;
-  enqueueTask([=]() {
-    auto mbOrErr = future->get();
-    if (mbOrErr.second) {
-      std::string msg =
-          "could not open '" + pathStr + "': " + mbOrErr.second.message();
-      // Check if the filename is a typo for an option flag. OptTable thinks
-      // that all args that are not known options and that start with / are
-      // filenames, but e.g. `/nodefaultlibs` is more likely a typo for
-      // the option `/nodefaultlib` than a reference to a file in the root
-      // directory.
-      std::string nearest;
-      if (COFFOptTable().findNearest(pathStr, nearest) > 1)
-        error(msg);
-      else
-        error(msg + "; did you mean '" + nearest + "'");
-    } else
-      driver->addBuffer(std::move(mbOrErr.first), wholeArchive);
-  });
+  auto prepare = [=]() {
+    input->mbOrErr = future->get();
+    if (input->mbOrErr.first)
+      input->obj = maybePreParse(input->mbOrErr.first->getMemBufferRef());
+  };
+  enqueueTask(
+      [=]() {
+        MBErrPair &mbOrErr = input->mbOrErr;
+        if (mbOrErr.second) {
+          std::string msg =
+              "could not open '" + pathStr + "': " + mbOrErr.second.message();
+          // Check if the filename is a typo for an option flag. OptTable thinks
+          // that all args that are not known options and that start with / are
+          // filenames, but e.g. `/nodefaultlibs` is more likely a typo for
+          // the option `/nodefaultlib` than a reference to a file in the root
+          // directory.
+          std::string nearest;
+          if (COFFOptTable().findNearest(pathStr, nearest) > 1)
+            error(msg);
+          else
+            error(msg + "; did you mean '" + nearest + "'");
+        } else
+          driver->addBuffer(std::move(mbOrErr.first), wholeArchive,
+                            std::move(input->obj));
+      },
+      prepare);
 }
 
-void LinkerDriver::addArchiveBuffer(MemoryBufferRef mb, StringRef symName,
-                                    StringRef parentName,
-                                    uint64_t offsetInArchive) {
+void LinkerDriver::addArchiveBuffer(
+    MemoryBufferRef mb, StringRef symName, StringRef parentName,
+    uint64_t offsetInArchive, std::unique_ptr<PreParsedObjFile> preParsed) {
   file_magic magic = identify_magic(mb.getBuffer());
   if (magic == file_magic::coff_import_library) {
     InputFile *imp = make<ImportFile>(mb);
@@ -257,7 +291,7 @@ void LinkerDriver::addArchiveBuffer(MemoryBufferRef mb, StringRef symName,
 
   InputFile *obj;
   if (magic == file_magic::coff_object) {
-    obj = make<ObjFile>(mb);
+    obj = make<ObjFile>(mb, std::move(preParsed));
   } else if (magic == file_magic::bitcode) {
     obj = make<BitcodeFile>(mb, parentName, offsetInArchive);
   } else {
@@ -286,10 +320,13 @@ void LinkerDriver::enqueueArchiveMember(const Archive::Child &c,
     if (!mbOrErr)
       reportBufferError(mbOrErr.takeError(), check(c.getFullName()));
     MemoryBufferRef mb = mbOrErr.get();
-    enqueueTask([=]() {
-      driver->addArchiveBuffer(mb, toCOFFString(sym), parentName,
-                               offsetInArchive);
-    });
+    auto input = std::make_shared<PreparedInput>();
+    enqueueTask(
+        [=]() {
+          driver->addArchiveBuffer(mb, toCOFFString(sym), parentName,
+                                   offsetInArchive, std::move(input->obj));
+        },
+        [=]() { input->obj = maybePreParse(mb); });
     return;
   }
 
@@ -299,14 +336,22 @@ void LinkerDriver::enqueueArchiveMember(const Archive::Child &c,
       toCOFFString(sym));
   auto future = std::make_shared<std::future<MBErrPair>>(
       createFutureForFile(childName));
-  enqueueTask([=]() {
-    auto mbOrErr = future->get();
-    if (mbOrErr.second)
-      reportBufferError(errorCodeToError(mbOrErr.second), childName);
-    driver->addArchiveBuffer(takeBuffer(std::move(mbOrErr.first)),
-                             toCOFFString(sym), parentName,
-                             /*OffsetInArchive=*/0);
-  });
+  auto input = std::make_shared<PreparedInput>();
+  auto prepare = [=]() {
+    input->mbOrErr = future->get();
+    if (input->mbOrErr.first)
+      input->obj = maybePreParse(input->mbOrErr.first->getMemBufferRef());
+  };
+  enqueueTask(
+      [=]() {
+        MBErrPair &mbOrErr = input->mbOrErr;
+        if (mbOrErr.second)
+          reportBufferError(errorCodeToError(mbOrErr.second), childName);
+        driver->addArchiveBuffer(takeBuffer(std::move(mbOrErr.first)),
+                                 toCOFFString(sym), parentName,
+                                 /*OffsetInArchive=*/0, std::move(input->obj));
+      },
+      prepare);
 }
 
 static bool isDecorated(StringRef sym) {
@@ -323,14 +368,17 @@ void LinkerDriver::parseDirectives(InputFile *file) {
 
   log("Directives: " + toString(file) + ": " + s);
 
-  ArgParser parser;
   // .drectve is always tokenized using Windows shell rules.
-  // /EXPORT: option can appear too many times, processing in fastpath.
-  opt::InputArgList args;
-  std::vector<StringRef> exports;
-  std::tie(args, exports) = parser.parseDirectives(s);
+  // Objects from the same library often have identical directives, so each
+  // distinct section is parsed only once.
+  ParsedDirectives *&directives = directivesCache[CachedHashStringRef(s)];
+  if (!directives)
+    directives = make<ParsedDirectives>(directivesParser.parseDirectives(s));
+
+  for (StringRef arg : directives->unknown)
+    warn("ignoring unknown argument: " + arg);
 
-  for (StringRef e : exports) {
+  for (StringRef e : directives->exports) {
     // If a common header file contains dllexported function
     // declarations, many object files may end up with having the
     // same /EXPORT options. In order to save cost of parsing them,
@@ -349,39 +397,39 @@ void LinkerDriver::parseDirectives(InputFile *file) {
     config->exports.push_back(exp);
   }
 
-  for (auto *arg : args) {
-    switch (arg->getOption().getID()) {
+  for (const ParsedDirectives::Directive &arg : directives->args) {
+    switch (arg.id) {
     case OPT_aligncomm:
-      parseAligncomm(arg->getValue());
+      parseAligncomm(arg.value);
       break;
     case OPT_alternatename:
-      parseAlternateName(arg->getValue());
+      parseAlternateName(arg.value);
       break;
     case OPT_defaultlib:
-      if (Optional<StringRef> path = findLib(arg->getValue()))
+      if (Optional<StringRef> path = findLib(arg.value))
         enqueuePath(*path, false);
       break;
     case OPT_entry:
-      config->entry = addUndefined(mangle(arg->getValue()));
+      config->entry = addUndefined(mangle(arg.value));
       break;
     case OPT_failifmismatch:
-      checkFailIfMismatch(arg->getValue(), file);
+      checkFailIfMismatch(arg.value, file);
       break;
     case OPT_incl:
-      addUndefined(arg->getValue());
+      addUndefined(arg.value);
       break;
     case OPT_merge:
-      parseMerge(arg->getValue());
+      parseMerge(arg.value);
       break;
     case OPT_nodefaultlib:
-      config->noDefaultLibs.insert(doFindLib(arg->getValue()).lower());
+      config->noDefaultLibs.insert(doFindLib(arg.value).lower());
       break;
     case OPT_section:
-      parseSection(arg->getValue());
+      parseSection(arg.value);
       break;
     case OPT_subsystem:
-      parseSubsystem(arg->getValue(), &config->subsystem,
-                     &config->majorOSVersion, &config->minorOSVersion);
+      parseSubsystem(arg.value, &config->subsystem, &config->majorOSVersion,
+                     &config->minorOSVersion);
       break;
     // Only add flags here that link.exe accepts in
     // `#pragma comment(linker, "/flag")`-generated sections.
@@ -390,7 +438,7 @@ void LinkerDriver::parseDirectives(InputFile *file) {
     case OPT_throwingnew:
       break;
     default:
-      error(arg->getSpelling() + " is not allowed in .drectve");
+      error(arg.spelling + " is not allowed in .drectve");
     }
   }
 }
@@ -844,8 +892,9 @@ static void parseModuleDefs(StringRef path) {
   }
 }
 
-void LinkerDriver::enqueueTask(std::function<void()> task) {
-  taskQueue.push_back(std::move(task));
+void LinkerDriver::enqueueTask(std::function<void()> task,
+                               std::function<void()> prepare) {
+  taskQueue.push_back({std::move(prepare), std::move(task)});
 }
 
 bool LinkerDriver::run() {
@@ -853,8 +902,25 @@ bool LinkerDriver::run() {
 
   bool didWork = !taskQueue.empty();
   while (!taskQueue.empty()) {
-    taskQueue.front()();
-    taskQueue.pop_front();
+    // Read and pre-parse all queued files in parallel, and then add them to
+    // the symbol table in order. Only file reading and name decoding run in
+    // parallel. Creating chunks and symbols allocates from the shared arena
+    // and resolves comdats against the symbol table, so it stays serial in
+    // ObjFile::parse(). Adding a file may queue more files, such as archive
+    // members or /defaultlib libraries, which we prepare in the next round.
+    std::vector<Task *> tasks;
+    for (Task &task : taskQueue)
+      if (task.prepare)
+        tasks.push_back(&task);
+    parallelForEach(tasks, [](Task *task) {
+      task->prepare();
+      task->prepare = nullptr;
+    });
+
+    while (!taskQueue.empty() && !taskQueue.front().prepare) {
+      taskQueue.front().run();
+      taskQueue.pop_front();
+    }
   }
   return didWork;
 }
@@ -1103,7 +1169,20 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
     return;
   }
 
-  lld::threadsEnabled = args.hasFlag(OPT_threads, OPT_threads_no, true);
+  // The last of the thread options wins.
+  lld::threadsEnabled = true;
+  lld::threadCount = 0;
+  if (auto *arg =
+          args.getLastArg(OPT_threads, OPT_threads_no, OPT_threads_count)) {
+    if (arg->getOption().getID() == OPT_threads_count) {
+      StringRef v = arg->getValue();
+      if (!to_integer(v, lld::threadCount, 10) || lld::threadCount == 0)
+        error("/threads: expected a positive integer, but got '" + v + "'");
+      lld::threadsEnabled = lld::threadCount > 1;
+    } else {
+      lld::threadsEnabled = arg->getOption().getID() == OPT_threads;
+    }
+  }
 
   if (args.hasArg(OPT_show_timing))
     config->showTiming = true;
@@ -1214,6 +1293,9 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
 
     if (auto *arg = args.getLastArg(OPT_pdb_source_path))
       config->pdbSourcePath = arg->getValue();
+
+    if (auto *arg = args.getLastArg(OPT_pdb_type_cache))
+      config->pdbTypeCacheDir = arg->getValue();
   }
 
   // Handle /noentry
@@ -1502,6 +1584,19 @@ void LinkerDriver::link(ArrayRef<const char *> argsArr) {
 
   config->mapFile = getMapFile(args);
 
+  // Handle /lldbuildidhash
+  if (auto *arg = args.getLastArg(OPT_lldbuildidhash)) {
+    StringRef s = arg->getValue();
+    if (s == "md5")
+      config->buildIdHash128 = true;
+    else if (s != "xxhash")
+      error("/lldbuildidhash: unknown hash: " + s);
+  }
+
+  // Handle /lldbaserelstats
+  if (auto *arg = args.getLastArg(OPT_lldbaserelstats))
+    config->baserelStatsFile = arg->getValue();
+
   if (config->incremental && args.hasArg(OPT_profile)) {
     warn("ignoring '/incremental' due to '/profile' specification");
     config->incremental = false;
@@ -13,6 +13,8 @@
 #include "SymbolTable.h"
 #include "lld/Common/LLVM.h"
 #include "lld/Common/Reproduce.h"
+#include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
@@ -32,6 +34,8 @@ namespace coff {
 class LinkerDriver;
 extern LinkerDriver *driver;
 
+struct PreParsedObjFile;
+
 using llvm::COFF::MachineTypes;
 using llvm::COFF::WindowsSubsystem;
 using llvm::Optional;
@@ -41,6 +45,23 @@ public:
   COFFOptTable();
 };
 
+// The options of a .drectve section. Parsing only depends on the section
+// contents, so the result can be shared by all objects with identical
+// directives.
+struct ParsedDirectives {
+  struct Directive {
+    unsigned id;
+    StringRef spelling;
+    StringRef value;
+  };
+
+  std::vector<Directive> args;
+  // /EXPORT options, which are processed in fastpath.
+  std::vector<StringRef> exports;
+  // Unknown options, as spelled in the section.
+  std::vector<StringRef> unknown;
+};
+
 class ArgParser {
 public:
   // Concatenate LINK environment variable and given arguments and parse them.
@@ -50,10 +71,8 @@ public:
   llvm::opt::InputArgList parse(StringRef s) { return parse(tokenize(s)); }
 
   // Tokenizes a given string and then parses as command line options in
-  // .drectve section. /EXPORT options are returned in second element
-  // to be processed in fastpath.
-  std::pair<llvm::opt::InputArgList, std::vector<StringRef>>
-  parseDirectives(StringRef s);
+  // .drectve section.
+  ParsedDirectives parseDirectives(StringRef s);
 
 private:
   // Parses command line options.
@@ -120,18 +139,33 @@ private:
   StringRef findDefaultEntry();
   WindowsSubsystem inferSubsystem();
 
-  void addBuffer(std::unique_ptr<MemoryBuffer> mb, bool wholeArchive);
+  void addBuffer(std::unique_ptr<MemoryBuffer> mb, bool wholeArchive,
+                 std::unique_ptr<PreParsedObjFile> preParsed = nullptr);
   void addArchiveBuffer(MemoryBufferRef mbref, StringRef symName,
-                        StringRef parentName, uint64_t offsetInArchive);
-
-  void enqueueTask(std::function<void()> task);
+                        StringRef parentName, uint64_t offsetInArchive,
+                        std::unique_ptr<PreParsedObjFile> preParsed = nullptr);
+
+  // A queued input file. prepare, if set, does the part of the work that does
+  // not depend on the rest of the link, and run() calls it in parallel for all
+  // queued tasks before running them in order.
+  struct Task {
+    std::function<void()> prepare;
+    std::function<void()> run;
+  };
+
+  void enqueueTask(std::function<void()> task,
+                   std::function<void()> prepare = nullptr);
   bool run();
 
-  std::list<std::function<void()>> taskQueue;
+  std::list<Task> taskQueue;
   std::vector<StringRef> filePaths;
   std::vector<MemoryBufferRef> resources;
 
   llvm::StringSet<> directivesExports;
+
+  // Parsed .drectve sections, keyed by their contents.
+  ArgParser directivesParser;
+  llvm::DenseMap<llvm::CachedHashStringRef, ParsedDirectives *> directivesCache;
 };
 
 // Functions below this line are defined in DriverUtils.cpp.
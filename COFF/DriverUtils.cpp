@@ -839,17 +839,45 @@ opt::InputArgList ArgParser::parse(ArrayRef<const char *> argv) {
 }
 
 // Tokenizes and parses a given string as command line in .drective section.
-// /EXPORT options are processed in fastpath.
-std::pair<opt::InputArgList, std::vector<StringRef>>
-ArgParser::parseDirectives(StringRef s) {
-  std::vector<StringRef> exports;
+// /EXPORT options and the most common options with values are processed in
+// fastpath, without going through the option table.
+ParsedDirectives ArgParser::parseDirectives(StringRef s) {
+  ParsedDirectives ret;
   SmallVector<const char *, 16> rest;
+  // The index in ret.args reserved for each element of rest, so that the
+  // options are kept in the order they appear in the section.
+  std::vector<size_t> restIndex;
+
+  auto startsWithOption = [](StringRef tok, StringRef name) {
+    return (tok.startswith("/") || tok.startswith("-")) &&
+           tok.substr(1).startswith_lower(name);
+  };
+
+  static const std::pair<unsigned, StringRef> fastOptions[] = {
+      {OPT_defaultlib, "defaultlib:"},
+      {OPT_failifmismatch, "failifmismatch:"},
+      {OPT_incl, "include:"},
+  };
 
   for (StringRef tok : tokenize(s)) {
-    if (tok.startswith_lower("/export:") || tok.startswith_lower("-export:"))
-      exports.push_back(tok.substr(strlen("/export:")));
-    else
-      rest.push_back(tok.data());
+    if (startsWithOption(tok, "export:")) {
+      ret.exports.push_back(tok.substr(strlen("/export:")));
+      continue;
+    }
+
+    auto it = llvm::find_if(
+        fastOptions, [&](const std::pair<unsigned, StringRef> &opt) {
+          return startsWithOption(tok, opt.second);
+        });
+    if (it != std::end(fastOptions)) {
+      size_t len = it->second.size() + 1;
+      ret.args.push_back({it->first, tok.take_front(len), tok.substr(len)});
+      continue;
+    }
+
+    restIndex.push_back(ret.args.size());
+    ret.args.push_back({OPT_INVALID, "", ""});
+    rest.push_back(tok.data());
   }
 
   // Make InputArgList from unparsed string vectors.
@@ -860,9 +888,22 @@ ArgParser::parseDirectives(StringRef s) {
 
   if (missingCount)
     fatal(Twine(args.getArgString(missingIndex)) + ": missing argument");
-  for (auto *arg : args.filtered(OPT_UNKNOWN))
-    warn("ignoring unknown argument: " + arg->getAsString(args));
-  return {std::move(args), std::move(exports)};
+  for (auto *arg : args) {
+    if (arg->getOption().getID() == OPT_UNKNOWN) {
+      ret.unknown.push_back(saver.save(arg->getAsString(args)));
+      continue;
+    }
+    StringRef value = arg->getNumValues() ? arg->getValue() : "";
+    ret.args[restIndex[arg->getIndex()]] = {arg->getOption().getID(),
+                                            saver.save(arg->getSpelling()),
+                                            saver.save(value)};
+  }
+
+  // Drop the slots of unknown options and of option values.
+  llvm::erase_if(ret.args, [](const ParsedDirectives::Directive &d) {
+    return d.id == OPT_INVALID;
+  });
+  return ret;
 }
 
 // link.exe has an interesting feature. If LINK or _LINK_ environment
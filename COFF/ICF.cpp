@@ -23,6 +23,7 @@
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Parallel.h"
@@ -53,6 +54,9 @@ private:
 
   bool isEligible(SectionChunk *c);
 
+  void collectDependencies();
+  bool isStable(size_t begin, size_t end);
+
   size_t findBoundary(size_t begin, size_t end);
 
   void forEachClassRange(size_t begin, size_t end,
@@ -63,6 +67,16 @@ private:
   std::vector<SectionChunk *> chunks;
   int cnt = 0;
   std::atomic<bool> repeat = {false};
+
+  // Each chunk subject to ICF is given an ID. For each ID, deps holds the IDs
+  // of the chunks whose classes equalsVariable looks at, and lastSplit the
+  // last iteration in which the class of the chunk was split. Like eqClass,
+  // lastSplit is double-buffered so that an iteration only reads what the
+  // previous one wrote.
+  DenseMap<const SectionChunk *, uint32_t> ids;
+  std::vector<std::vector<uint32_t>> deps;
+  std::vector<int> lastSplit[2];
+  std::atomic<size_t> numStable = {0};
 };
 
 // Returns true if section S is subject of ICF.
@@ -99,8 +113,82 @@ bool ICF::isEligible(SectionChunk *c) {
   return !c->keepUnique;
 }
 
+// Associative children that ICF ignores when comparing sections.
+static bool isIgnoredChild(const SectionChunk &c) {
+  return c.getSectionName().startswith(".debug") ||
+         c.getSectionName() == ".gfids$y" || c.getSectionName() == ".gljmp$y";
+}
+
+// Returns a hash of everything equalsConstant compares, except for the
+// classes of relocation targets.
+static uint32_t getConstantHash(const SectionChunk *sc) {
+  uint64_t hash = hash_combine(xxHash64(sc->getContents()),
+                               sc->getOutputCharacteristics(),
+                               sc->getSectionName(), sc->relocsSize);
+  for (const coff_relocation &rel : sc->getRelocs()) {
+    hash = hash_combine(hash, uint16_t(rel.Type), uint32_t(rel.VirtualAddress));
+    Symbol *b = sc->file->getSymbol(rel.SymbolTableIndex);
+    if (auto *d = dyn_cast_or_null<DefinedRegular>(b))
+      hash = hash_combine(hash, d->getValue());
+    else if (b)
+      hash = hash_combine(hash, b->kind());
+  }
+  for (const SectionChunk &c : sc->children())
+    if (!isIgnoredChild(c))
+      hash = hash_combine(hash, xxHash64(c.getContents()));
+  return hash;
+}
+
+// Builds the dependency lists used by isStable.
+void ICF::collectDependencies() {
+  for (size_t i = 0, e = chunks.size(); i != e; ++i)
+    ids[chunks[i]] = i;
+  deps.resize(chunks.size());
+
+  // Nothing is stable in the first iteration.
+  lastSplit[0].assign(chunks.size(), cnt - 1);
+  lastSplit[1].assign(chunks.size(), cnt - 1);
+
+  parallelForEachN(0, chunks.size(), [&](size_t i) {
+    std::vector<uint32_t> &v = deps[i];
+    auto add = [&](const SectionChunk *c) {
+      auto it = ids.find(c);
+      if (it != ids.end())
+        v.push_back(it->second);
+    };
+    for (Symbol *b : chunks[i]->symbols())
+      if (auto *d = dyn_cast_or_null<DefinedRegular>(b))
+        add(d->getChunk());
+    for (const SectionChunk &c : chunks[i]->children())
+      if (!isIgnoredChild(c))
+        add(&c);
+    llvm::sort(v);
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+  });
+}
+
+// Returns true if no class that equalsVariable looks at for the chunks in
+// [Begin, End) was split in the previous iteration. Such a class was already
+// compared against the same information and cannot split now.
+bool ICF::isStable(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i)
+    for (uint32_t dep : deps[ids.lookup(chunks[i])])
+      if (lastSplit[(cnt + 1) % 2][dep] == cnt - 1)
+        return false;
+  return true;
+}
+
 // Split an equivalence class into smaller classes.
 void ICF::segregate(size_t begin, size_t end, bool constant) {
+  if (!constant && isStable(begin, end)) {
+    for (size_t i = begin; i < end; ++i)
+      chunks[i]->eqClass[(cnt + 1) % 2] = end;
+    ++numStable;
+    return;
+  }
+
+  size_t classBegin = begin;
+  bool split = false;
   while (begin < end) {
     // Divide [Begin, End) into two. Let Mid be the start index of the
     // second group.
@@ -119,10 +207,15 @@ void ICF::segregate(size_t begin, size_t end, bool constant) {
 
     // If we created a group, we need to iterate the main loop again.
     if (mid != end)
-      repeat = true;
+      repeat = split = true;
 
     begin = mid;
   }
+
+  // Classes that depend on this one need to be compared again.
+  if (split && !constant)
+    for (size_t i = classBegin; i < end; ++i)
+      lastSplit[cnt % 2][ids.lookup(chunks[i])] = cnt;
 }
 
 // Returns true if two sections' associative children are equal.
@@ -130,8 +223,7 @@ bool ICF::assocEquals(const SectionChunk *a, const SectionChunk *b) {
   auto childClasses = [&](const SectionChunk *sc) {
     std::vector<uint32_t> classes;
     for (const SectionChunk &c : sc->children())
-      if (!c.getSectionName().startswith(".debug") &&
-          c.getSectionName() != ".gfids$y" && c.getSectionName() != ".gljmp$y")
+      if (!isIgnoredChild(c))
         classes.push_back(c.eqClass[cnt % 2]);
     return classes;
   };
@@ -261,9 +353,11 @@ void ICF::run(ArrayRef<Chunk *> vec) {
       for (SectionChunk *sc : mc->sections)
         sc->eqClass[0] = nextId++;
 
-  // Initially, we use hash values to partition sections.
+  // Initially, we use hash values to partition sections. The hash covers the
+  // contents, the relocations and the associative children so that most
+  // classes are final before any section is compared.
   parallelForEach(chunks, [&](SectionChunk *sc) {
-    sc->eqClass[0] = xxHash64(sc->getContents());
+    sc->eqClass[0] = getConstantHash(sc);
   });
 
   // Combine the hashes of the sections referenced by each section into its
@@ -289,6 +383,9 @@ void ICF::run(ArrayRef<Chunk *> vec) {
   forEachClass([&](size_t begin, size_t end) { segregate(begin, end, true); });
 
   // Split groups by comparing relocations until convergence is obtained.
+  // A class is compared again only if a class it depends on was split in
+  // the previous iteration.
+  collectDependencies();
   do {
     repeat = false;
     forEachClass(
@@ -296,8 +393,11 @@ void ICF::run(ArrayRef<Chunk *> vec) {
   } while (repeat);
 
   log("ICF needed " + Twine(cnt) + " iterations");
+  log("ICF skipped " + Twine(numStable.load()) + " stable classes");
 
   // Merge sections in the same classs.
+  std::atomic<size_t> numFolded = {0};
+  std::atomic<size_t> bytesFolded = {0};
   forEachClass([&](size_t begin, size_t end) {
     if (end - begin == 1)
       return;
@@ -305,9 +405,16 @@ void ICF::run(ArrayRef<Chunk *> vec) {
     log("Selected " + chunks[begin]->getDebugName());
     for (size_t i = begin + 1; i < end; ++i) {
       log("  Removed " + chunks[i]->getDebugName());
+      ++numFolded;
+      bytesFolded += chunks[i]->getSize();
       chunks[begin]->replace(chunks[i]);
     }
   });
+
+  t.stop();
+  log("ICF folded " + Twine(numFolded.load()) + " sections (" +
+      Twine(bytesFolded.load()) + " bytes) in " +
+      Twine(uint64_t(icfTimer.millis())) + " ms");
 }
 
 // Entry point to ICF.
@@ -116,15 +116,73 @@ std::vector<MemoryBufferRef> getArchiveMembers(Archive *file) {
   return v;
 }
 
-void ObjFile::parse() {
-  // Parse a memory buffer as a COFF file.
-  std::unique_ptr<Binary> bin = CHECK(createBinary(mb), this);
+std::unique_ptr<PreParsedObjFile>
+lld::coff::preParseObjFile(MemoryBufferRef mb) {
+  Expected<std::unique_ptr<Binary>> binOrErr = createBinary(mb);
+  if (!binOrErr) {
+    consumeError(binOrErr.takeError());
+    return nullptr;
+  }
+  auto *obj = dyn_cast<COFFObjectFile>(binOrErr->get());
+  if (!obj)
+    return nullptr;
+
+  auto ret = llvm::make_unique<PreParsedObjFile>();
+  binOrErr->release();
+  ret->coffObj.reset(obj);
 
-  if (auto *obj = dyn_cast<COFFObjectFile>(bin.get())) {
-    bin.release();
-    coffObj.reset(obj);
+  uint32_t numSections = obj->getNumberOfSections();
+  ret->sectionNames.reserve(numSections + 1);
+  ret->sectionNames.push_back("");
+  for (uint32_t i = 1; i < numSections + 1; ++i) {
+    const coff_section *sec;
+    if (obj->getSection(i, sec))
+      break;
+    Expected<StringRef> name = obj->getSectionName(sec);
+    if (!name) {
+      consumeError(name.takeError());
+      break;
+    }
+    ret->sectionNames.push_back(*name);
+  }
+
+  uint32_t numSymbols = obj->getNumberOfSymbols();
+  ret->symbolNames.reserve(numSymbols);
+  for (uint32_t i = 0; i < numSymbols; ++i) {
+    Expected<COFFSymbolRef> sym = obj->getSymbol(i);
+    if (!sym) {
+      consumeError(sym.takeError());
+      break;
+    }
+    StringRef name;
+    obj->getSymbolName(*sym, name);
+    ret->symbolNames.push_back(name);
+
+    // Auxiliary symbols have no names.
+    uint32_t numAux = std::min<uint32_t>(sym->getNumberOfAuxSymbols(),
+                                         numSymbols - i - 1);
+    ret->symbolNames.resize(ret->symbolNames.size() + numAux);
+    i += numAux;
+  }
+  return ret;
+}
+
+void ObjFile::parse() {
+  // Files added by the driver, including lazily loaded archive members, are
+  // pre-parsed in parallel beforehand. Only LTO output and the resource object
+  // are parsed here directly, since building their name tables serially would
+  // only add work.
+  if (preParsed) {
+    coffObj = std::move(preParsed->coffObj);
   } else {
-    fatal(toString(this) + " is not a COFF file");
+    std::unique_ptr<Binary> bin = CHECK(createBinary(mb), this);
+
+    if (auto *obj = dyn_cast<COFFObjectFile>(bin.get())) {
+      bin.release();
+      coffObj.reset(obj);
+    } else {
+      fatal(toString(this) + " is not a COFF file");
+    }
   }
 
   // Read section and symbol tables.
@@ -132,6 +190,7 @@ void ObjFile::parse() {
   initializeSymbols();
   initializeFlags();
   initializeDependencies();
+  preParsed.reset();
 }
 
 const coff_section* ObjFile::getSection(uint32_t i) {
@@ -141,6 +200,28 @@ const coff_section* ObjFile::getSection(uint32_t i) {
   return sec;
 }
 
+StringRef ObjFile::getSectionName(uint32_t sectionNumber,
+                                  const coff_section *sec) {
+  if (preParsed && sectionNumber < preParsed->sectionNames.size())
+    return preParsed->sectionNames[sectionNumber];
+  Expected<StringRef> e = coffObj->getSectionName(sec);
+  if (!e)
+    fatal("getSectionName failed: #" + Twine(sectionNumber) + ": " +
+          toString(e.takeError()));
+  return *e;
+}
+
+StringRef ObjFile::getSymbolName(COFFSymbolRef sym) {
+  if (preParsed) {
+    uint32_t i = coffObj->getSymbolIndex(sym);
+    if (i < preParsed->symbolNames.size())
+      return preParsed->symbolNames[i];
+  }
+  StringRef name;
+  coffObj->getSymbolName(sym, name);
+  return name;
+}
+
 // We set SectionChunk pointers in the SparseChunks vector to this value
 // temporarily to mark comdat sections as having an unknown resolution. As we
 // walk the object file's symbol table, once we visit either a leader symbol or
@@ -167,13 +248,7 @@ SectionChunk *ObjFile::readSection(uint32_t sectionNumber,
                                    StringRef leaderName) {
   const coff_section *sec = getSection(sectionNumber);
 
-  StringRef name;
-  if (Expected<StringRef> e = coffObj->getSectionName(sec))
-    name = *e;
-  else
-    fatal("getSectionName failed: #" + Twine(sectionNumber) + ": " +
-          toString(e.takeError()));
-
+  StringRef name = getSectionName(sectionNumber, sec);
   if (name == ".drectve") {
     ArrayRef<uint8_t> data;
     cantFail(coffObj->getSectionContents(sec, data));
@@ -286,8 +361,7 @@ void ObjFile::recordPrevailingSymbolForMingw(
   int32_t sectionNumber = sym.getSectionNumber();
   SectionChunk *sc = sparseChunks[sectionNumber];
   if (sc && sc->getOutputCharacteristics() & IMAGE_SCN_MEM_EXECUTE) {
-    StringRef name;
-    coffObj->getSymbolName(sym, name);
+    StringRef name = getSymbolName(sym);
     if (getMachineType() == I386)
       name.consume_front("_");
     prevailingSectionMap[name] = sectionNumber;
@@ -297,8 +371,7 @@ void ObjFile::recordPrevailingSymbolForMingw(
 void ObjFile::maybeAssociateSEHForMingw(
     COFFSymbolRef sym, const coff_aux_section_definition *def,
     const DenseMap<StringRef, uint32_t> &prevailingSectionMap) {
-  StringRef name;
-  coffObj->getSymbolName(sym, name);
+  StringRef name = getSymbolName(sym);
   if (name.consume_front(".pdata$") || name.consume_front(".xdata$") ||
       name.consume_front(".eh_frame$")) {
     // For MinGW, treat .[px]data$<func> and .eh_frame$<func> as implicitly
@@ -312,8 +385,7 @@ void ObjFile::maybeAssociateSEHForMingw(
 Symbol *ObjFile::createRegular(COFFSymbolRef sym) {
   SectionChunk *sc = sparseChunks[sym.getSectionNumber()];
   if (sym.isExternal()) {
-    StringRef name;
-    coffObj->getSymbolName(sym, name);
+    StringRef name = getSymbolName(sym);
     if (sc)
       return symtab->addRegular(this, name, sym.getGeneric(), sc);
     // For MinGW symbols named .weak.* that point to a discarded section,
@@ -380,8 +452,7 @@ void ObjFile::initializeSymbols() {
         maybeAssociateSEHForMingw(sym, def, prevailingSectionMap);
     }
     if (sparseChunks[sym.getSectionNumber()] == pendingComdat) {
-      StringRef name;
-      coffObj->getSymbolName(sym, name);
+      StringRef name = getSymbolName(sym);
       log("comdat section " + name +
           " without leader and unassociated, discarding");
       continue;
@@ -397,8 +468,7 @@ void ObjFile::initializeSymbols() {
 }
 
 Symbol *ObjFile::createUndefined(COFFSymbolRef sym) {
-  StringRef name;
-  coffObj->getSymbolName(sym, name);
+  StringRef name = getSymbolName(sym);
   return symtab->addUndefined(name, this, sym.isWeakExternal());
 }
 
@@ -483,8 +553,7 @@ void ObjFile::handleComdatSelection(COFFSymbolRef sym, COMDATType &selection,
   case IMAGE_COMDAT_SELECT_LARGEST:
     if (leaderChunk->getSize() < getSection(sym)->SizeOfRawData) {
       // Replace the existing comdat symbol with the new one.
-      StringRef name;
-      coffObj->getSymbolName(sym, name);
+      StringRef name = getSymbolName(sym);
       // FIXME: This is incorrect: With /opt:noref, the previous sections
       // make it into the final executable as well. Correct handling would
       // be to undo reading of the whole old section that's being replaced,
@@ -508,11 +577,7 @@ Optional<Symbol *> ObjFile::createDefined(
     std::vector<const coff_aux_section_definition *> &comdatDefs,
     bool &prevailing) {
   prevailing = false;
-  auto getName = [&]() {
-    StringRef s;
-    coffObj->getSymbolName(sym, s);
-    return s;
-  };
+  auto getName = [&]() { return getSymbolName(sym); };
 
   if (sym.isCommon()) {
     auto *c = make<CommonChunk>(sym);
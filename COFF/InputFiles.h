@@ -19,6 +19,7 @@
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/COFF.h"
 #include "llvm/Support/StringSaver.h"
+#include <atomic>
 #include <memory>
 #include <set>
 #include <vector>
@@ -34,6 +35,22 @@ namespace coff {
 
 std::vector<MemoryBufferRef> getArchiveMembers(llvm::object::Archive *file);
 
+// The COFF headers and the section and symbol names of an object file.
+// Reading them does not depend on the rest of the link, so the driver does
+// it for queued input files in parallel before they are parsed one by one.
+struct PreParsedObjFile {
+  std::unique_ptr<llvm::object::COFFObjectFile> coffObj;
+
+  // Indexed by section number and symbol index. Names that could not be
+  // read are missing from the end, and are read again (and their errors
+  // reported) by ObjFile::parse().
+  std::vector<StringRef> sectionNames;
+  std::vector<StringRef> symbolNames;
+};
+
+// Returns null if the buffer is not a valid COFF object file.
+std::unique_ptr<PreParsedObjFile> preParseObjFile(MemoryBufferRef mb);
+
 using llvm::COFF::IMAGE_FILE_MACHINE_UNKNOWN;
 using llvm::COFF::MachineTypes;
 using llvm::object::Archive;
@@ -52,6 +69,7 @@ class SectionChunk;
 class Symbol;
 class Undefined;
 class TpiSource;
+struct LineTableIndex;
 
 // The root class of input files.
 class InputFile {
@@ -107,6 +125,8 @@ private:
 class ObjFile : public InputFile {
 public:
   explicit ObjFile(MemoryBufferRef m) : InputFile(ObjectKind, m) {}
+  ObjFile(MemoryBufferRef m, std::unique_ptr<PreParsedObjFile> preParsed)
+      : InputFile(ObjectKind, m), preParsed(std::move(preParsed)) {}
   static bool classof(const InputFile *f) { return f->kind() == ObjectKind; }
   void parse() override;
   MachineTypes getMachineType() override;
@@ -177,12 +197,19 @@ public:
   // The .debug$T stream if there's one.
   llvm::Optional<llvm::codeview::CVTypeArray> debugTypes;
 
+  // The CodeView line tables of this file, indexed by getFileLine() on first
+  // use.
+  LineTableIndex *lineTableIndex = nullptr;
+
 private:
   const coff_section* getSection(uint32_t i);
   const coff_section *getSection(COFFSymbolRef sym) {
     return getSection(sym.getSectionNumber());
   }
 
+  StringRef getSectionName(uint32_t sectionNumber, const coff_section *sec);
+  StringRef getSymbolName(COFFSymbolRef sym);
+
   void initializeChunks();
   void initializeSymbols();
   void initializeFlags();
@@ -230,6 +257,9 @@ private:
 
   std::unique_ptr<COFFObjectFile> coffObj;
 
+  // Set until parse() returns if the driver pre-parsed the file.
+  std::unique_ptr<PreParsedObjFile> preParsed;
+
   // List of all chunks defined by this file. This includes both section
   // chunks and non-section chunks for common symbols.
   std::vector<Chunk *> chunks;
@@ -290,9 +320,10 @@ public:
   // If the Live bit is turned off by MarkLive, Writer will ignore dllimported
   // symbols provided by this import library member. We also track whether the
   // imported symbol is used separately from whether the thunk is used in order
-  // to avoid creating unnecessary thunks.
-  bool live = !config->doGC;
-  bool thunkLive = !config->doGC;
+  // to avoid creating unnecessary thunks. They are atomic because MarkLive may
+  // set them from several threads.
+  std::atomic<bool> live{!config->doGC};
+  std::atomic<bool> thunkLive{!config->doGC};
 };
 
 // Used for LTO.
@@ -8,6 +8,7 @@
 
 #include "Chunks.h"
 #include "Symbols.h"
+#include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
 #include "llvm/ADT/STLExtras.h"
 #include <vector>
@@ -17,6 +18,73 @@ namespace coff {
 
 static Timer gctimer("GC", Timer::root());
 
+// Marks what symbol B refers to as live. Chunks are passed to enqueue, which
+// sets their live bits.
+static void markSymbol(Symbol *b,
+                       llvm::function_ref<void(SectionChunk *)> enqueue) {
+  if (auto *sym = dyn_cast<DefinedRegular>(b))
+    enqueue(sym->getChunk());
+  else if (auto *sym = dyn_cast<DefinedImportData>(b))
+    sym->file->live = true;
+  else if (auto *sym = dyn_cast<DefinedImportThunk>(b))
+    sym->wrappedSym->file->live = sym->wrappedSym->file->thunkLive = true;
+}
+
+// Marks everything section SC refers to as live.
+static void markChunk(SectionChunk *sc,
+                      llvm::function_ref<void(SectionChunk *)> enqueue) {
+  assert(sc->live && "We mark as live when pushing onto the worklist!");
+
+  // Mark all symbols listed in the relocation table for this section.
+  for (Symbol *b : sc->symbols())
+    if (b)
+      markSymbol(b, enqueue);
+
+  // Mark associative sections if any.
+  for (SectionChunk &c : sc->children())
+    enqueue(&c);
+}
+
+// Marks the sections reachable from the worklist using multiple threads.
+//
+// The worklist is split into shards, and each thread traverses the graph
+// depth-first from its shard using a private stack. To keep the threads
+// balanced, a thread stops after visiting a fixed number of sections, and the
+// sections left on all stacks are split into new shards for the next round.
+// A section is claimed by the thread that flips its live bit.
+static void markLiveParallel(std::vector<SectionChunk *> worklist) {
+  const size_t maxShards = 256;
+  const size_t maxVisits = 4096;
+
+  while (!worklist.empty()) {
+    size_t numShards = std::min(maxShards, worklist.size());
+    std::vector<std::vector<SectionChunk *>> stacks(numShards);
+
+    parallelForEachN(0, numShards, [&](size_t shard) {
+      std::vector<SectionChunk *> &stack = stacks[shard];
+      stack.assign(worklist.begin() + worklist.size() * shard / numShards,
+                   worklist.begin() +
+                       worklist.size() * (shard + 1) / numShards);
+
+      auto enqueue = [&](SectionChunk *c) {
+        if (c->live || c->live.exchange(true))
+          return;
+        stack.push_back(c);
+      };
+
+      for (size_t i = 0; i < maxVisits && !stack.empty(); ++i) {
+        SectionChunk *sc = stack.back();
+        stack.pop_back();
+        markChunk(sc, enqueue);
+      }
+    });
+
+    worklist.clear();
+    for (std::vector<SectionChunk *> &stack : stacks)
+      worklist.insert(worklist.end(), stack.begin(), stack.end());
+  }
+}
+
 // Set live bit on for each reachable chunk. Unmarked (unreachable)
 // COMDAT chunks will be ignored by Writer, so they will be excluded
 // from the final output.
@@ -26,7 +94,7 @@ void markLive(ArrayRef<Chunk *> chunks) {
   // We build up a worklist of sections which have been marked as live. We only
   // push into the worklist when we discover an unmarked section, and we mark
   // as we push, so sections never appear twice in the list.
-  SmallVector<SectionChunk *, 256> worklist;
+  std::vector<SectionChunk *> worklist;
 
   // COMDAT section chunks are dead by default. Add non-COMDAT chunks.
   for (Chunk *c : chunks)
@@ -41,31 +109,19 @@ void markLive(ArrayRef<Chunk *> chunks) {
     worklist.push_back(c);
   };
 
-  auto addSym = [&](Symbol *b) {
-    if (auto *sym = dyn_cast<DefinedRegular>(b))
-      enqueue(sym->getChunk());
-    else if (auto *sym = dyn_cast<DefinedImportData>(b))
-      sym->file->live = true;
-    else if (auto *sym = dyn_cast<DefinedImportThunk>(b))
-      sym->wrappedSym->file->live = sym->wrappedSym->file->thunkLive = true;
-  };
-
   // Add GC root chunks.
   for (Symbol *b : config->gcroot)
-    addSym(b);
-
-  while (!worklist.empty()) {
-    SectionChunk *sc = worklist.pop_back_val();
-    assert(sc->live && "We mark as live when pushing onto the worklist!");
+    markSymbol(b, enqueue);
 
-    // Mark all symbols listed in the relocation table for this section.
-    for (Symbol *b : sc->symbols())
-      if (b)
-        addSym(b);
+  if (threadsEnabled && getThreadLimit() != 1) {
+    markLiveParallel(std::move(worklist));
+    return;
+  }
 
-    // Mark associative sections if any.
-    for (SectionChunk &c : sc->children())
-      enqueue(&c);
+  while (!worklist.empty()) {
+    SectionChunk *sc = worklist.back();
+    worklist.pop_back();
+    markChunk(sc, enqueue);
   }
 }
 
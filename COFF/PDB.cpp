@@ -16,6 +16,7 @@
 #include "TypeMerger.h"
 #include "Writer.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
 #include "lld/Common/Timer.h"
 #include "lld/Common/Threads.h"
 #include "llvm/DebugInfo/CodeView/DebugFrameDataSubsection.h"
@@ -57,7 +58,11 @@
 #include "llvm/Support/JamCRC.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <tuple>
 
 using namespace lld;
 using namespace lld::coff;
@@ -80,6 +85,26 @@ static Timer diskCommitTimer("Commit to Disk", totalPdbLinkTimer);
 namespace {
 class DebugSHandler;
 
+// The type stream of an object file whose records are added to the PDB by
+// addGHashLeaders().
+struct GHashSource {
+  ObjFile *file;
+  std::vector<ArrayRef<uint8_t>> records;
+  ArrayRef<GloballyHashedType> hashes;
+  std::vector<GloballyHashedType> ownedHashes;
+
+  // For each record, the GHashTable entry of the first record with the
+  // same hash. A record is a leader if this is the record itself.
+  std::vector<uint64_t> leaders;
+
+  // For each leader, its index in the destination TPI or IPI stream, and its
+  // copy in the destination type table if it was not there yet.
+  std::vector<TypeIndex> destIndices;
+  std::vector<MutableArrayRef<uint8_t>> destRecords;
+
+  CVIndexMap indexMap;
+};
+
 class PDBLinker {
   friend DebugSHandler;
 
@@ -104,10 +129,10 @@ public:
   /// Link info for each import file in the symbol table into the PDB.
   void addImportFilesToPDB(ArrayRef<OutputSection *> outputSections);
 
-  /// Link CodeView from a single object file into the target (output) PDB.
-  /// When a precompiled headers object is linked, its TPI map might be provided
-  /// externally.
-  void addObjFile(ObjFile *file, CVIndexMap *externIndexMap = nullptr);
+  /// Merge the type records of a single object file into the target (output)
+  /// PDB and queue the object for symbol merging. When a precompiled headers
+  /// object is linked, its TPI map might be provided externally.
+  void addObjFileTypes(ObjFile *file, CVIndexMap *externIndexMap = nullptr);
 
   /// Produce a mapping from the type and item indices used in the object
   /// file to those in the destination PDB.
@@ -123,6 +148,21 @@ public:
   Expected<const CVIndexMap &> mergeDebugT(ObjFile *file,
                                            CVIndexMap *objectIndexMap);
 
+  /// Compute the global hashes of the type and item records of all objects
+  /// that neither use nor provide precompiled headers or a type server, and
+  /// find the first record with each hash, in parallel. This is only used for
+  /// /DEBUG:GHASH.
+  void findGHashLeaders();
+
+  /// Add the records of an object that were found first by findGHashLeaders()
+  /// to the destination type tables. This is called by mergeDebugT() in the
+  /// same order as a serial merge, so the records get the same indices.
+  const CVIndexMap &addGHashLeaders(size_t srcIdx);
+
+  /// Build the index maps of the objects added by addGHashLeaders() and
+  /// rewrite the type indices in the records they added, in parallel.
+  void remapGHashSources();
+
   /// Reads and makes available a PDB.
   Expected<const CVIndexMap &> maybeMergeTypeServerPDB(ObjFile *file);
 
@@ -146,10 +186,6 @@ public:
   std::pair<CVIndexMap &, bool /*already there*/>
   registerPrecompiledHeaders(uint32_t signature);
 
-  void mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
-                          std::vector<ulittle32_t *> &stringTableRefs,
-                          BinaryStreamRef symData);
-
   /// Add the section map and section contributions to the PDB.
   void addSections(ArrayRef<OutputSection *> outputSections,
                    ArrayRef<uint8_t> sectionTable);
@@ -184,6 +220,19 @@ private:
   /// far.
   std::map<uint32_t, CVIndexMap> precompTypeIndexMappings;
 
+  /// Objects whose records were hashed by findGHashLeaders(), in
+  /// ObjFile::instances order, and their indices in that vector.
+  std::vector<GHashSource> ghashSources;
+  DenseMap<const ObjFile *, size_t> ghashSourceIndices;
+
+  /// Type index mappings of objects that are not shared with other objects.
+  std::deque<CVIndexMap> objectIndexMaps;
+
+  /// Objects whose types have been merged, in the order they were merged.
+  /// Their symbols are merged in parallel afterwards, and the handlers own
+  /// memory referenced by the module streams.
+  std::vector<std::unique_ptr<DebugSHandler>> modules;
+
   // For statistics
   uint64_t globalSymbols = 0;
   uint64_t moduleSymbols = 0;
@@ -199,6 +248,21 @@ class DebugSHandler {
   /// The result of merging type indices.
   const CVIndexMap &indexMap;
 
+  /// Memory for the relocated .debug$S and .debug$F sections and realigned
+  /// symbol records of this object. Each object has its own allocator, so
+  /// that objects can be handled in parallel.
+  BumpPtrAllocator alloc;
+
+  /// Records for the globals stream and their offsets in the module stream.
+  /// The globals stream is shared by all modules, so these are added by
+  /// finish().
+  std::vector<std::pair<uint32_t, CVSymbol>> globalSymbols;
+
+  /// Old-style FPO records from .debug$F sections, added by finish().
+  std::vector<object::FpoData> oldFpoData;
+
+  uint64_t numModuleSymbols = 0;
+
   /// The DEBUG_S_STRINGTABLE subsection.  These strings are referred to by
   /// index from other records in the .debug$S section.  All of these strings
   /// need to be added to the global PDB string table, and all references to
@@ -230,15 +294,38 @@ class DebugSHandler {
   /// references.
   std::vector<ulittle32_t *> stringTableReferences;
 
+  /// Diagnostics found by handleDebugSections(). Objects are handled in
+  /// parallel, so they are reported by finish() in merge order instead. A
+  /// fatal error is always the last one, since handling stops there.
+  enum DiagnosticKind { Log, Warning, Fatal };
+  std::vector<std::pair<DiagnosticKind, std::string>> diagnostics;
+  bool failed = false;
+
+  /// Records a fatal error if E is an error, and returns false if so.
+  bool check(Error e);
+
 public:
   DebugSHandler(PDBLinker &linker, ObjFile &file, const CVIndexMap &indexMap)
       : linker(linker), file(file), indexMap(indexMap) {}
 
+  void addLog(const Twine &msg);
+  void addWarning(const Twine &msg);
+  void addFatal(const Twine &msg);
+
+  /// Process all live .debug$S and .debug$F sections of the object and add
+  /// the results to its module stream. This does not modify any PDB-wide
+  /// state, so it can be called for different objects in parallel.
+  void handleDebugSections();
+
   void handleDebugS(lld::coff::SectionChunk &debugS);
 
+  void mergeSymbolRecords(BinaryStreamRef symData);
+
   std::shared_ptr<DebugInlineeLinesSubsection>
   mergeInlineeLines(DebugChecksumsSubsection *newChecksums);
 
+  /// Add the parts that need the PDB-wide string table, globals stream and
+  /// DBI stream. This must be called for each object in order.
   void finish();
 };
 }
@@ -339,6 +426,11 @@ PDBLinker::mergeDebugT(ObjFile *file, CVIndexMap *objectIndexMap) {
   if (!file->debugTypesObj)
     return *objectIndexMap; // no Types stream
 
+  // Objects hashed by findGHashLeaders() only need to add their leaders.
+  auto ghashIt = ghashSourceIndices.find(file);
+  if (ghashIt != ghashSourceIndices.end())
+    return addGHashLeaders(ghashIt->second);
+
   // Precompiled headers objects need to save the index map for further
   // reference by other objects which use the precompiled headers.
   if (file->debugTypesObj->kind == TpiSource::PCH) {
@@ -393,9 +485,20 @@ PDBLinker::mergeDebugT(ObjFile *file, CVIndexMap *objectIndexMap) {
   if (config->debugGHashes) {
     ArrayRef<GloballyHashedType> hashes;
     std::vector<GloballyHashedType> ownedHashes;
-    if (Optional<ArrayRef<uint8_t>> debugH = getDebugH(file))
+    if (Optional<ArrayRef<uint8_t>> debugH = getDebugH(file)) {
       hashes = getHashesFromDebugH(*debugH);
-    else {
+    } else if (file->debugTypesObj->kind == TpiSource::PCH) {
+      // Precompiled headers objects are shared by many links, so their hashes
+      // are cached by signature if /pdbtypecache is given.
+      uint32_t numTypes = std::distance(types.begin(), types.end());
+      std::string cacheKey = getPrecompCacheKey(*file->pchSignature);
+      uint64_t contentHash = getGHashCacheContentHash(types, nullptr);
+      if (!readGHashCache(cacheKey, numTypes, 0, contentHash, ownedHashes)) {
+        ownedHashes = GloballyHashedType::hashTypes(types);
+        writeGHashCache(cacheKey, numTypes, contentHash, ownedHashes);
+      }
+      hashes = ownedHashes;
+    } else {
       ownedHashes = GloballyHashedType::hashTypes(types);
       hashes = ownedHashes;
     }
@@ -447,8 +550,28 @@ Expected<const CVIndexMap &> PDBLinker::maybeMergeTypeServerPDB(ObjFile *file) {
     // PDB we have to synthesize global hashes.  To do this, we first synthesize
     // global hashes for the TPI stream, since it is independent, then we
     // synthesize hashes for the IPI stream, using the hashes for the TPI stream
-    // as inputs.
-    auto tpiHashes = GloballyHashedType::hashTypes(expectedTpi->typeArray());
+    // as inputs. The hashes are cached across links by GUID and age if
+    // /pdbtypecache is given.
+    uint32_t numTypes = expectedTpi->getNumTypeRecords();
+    uint32_t numIds = maybeIpi ? maybeIpi->getNumTypeRecords() : 0;
+    std::string cacheKey = getTypeServerCacheKey(info.getGuid(), info.getAge());
+    uint64_t contentHash = getGHashCacheContentHash(
+        expectedTpi->typeArray(), maybeIpi ? &maybeIpi->typeArray() : nullptr);
+    std::vector<GloballyHashedType> hashes;
+    if (!readGHashCache(cacheKey, numTypes, numIds, contentHash, hashes)) {
+      hashes = GloballyHashedType::hashTypes(expectedTpi->typeArray());
+      if (maybeIpi) {
+        std::vector<GloballyHashedType> ipiHashes =
+            GloballyHashedType::hashIds(maybeIpi->typeArray(), hashes);
+        hashes.insert(hashes.end(), ipiHashes.begin(), ipiHashes.end());
+      }
+      writeGHashCache(cacheKey, numTypes, contentHash, hashes);
+    }
+    ArrayRef<GloballyHashedType> tpiHashes =
+        makeArrayRef(hashes).take_front(numTypes);
+    ArrayRef<GloballyHashedType> ipiHashes =
+        makeArrayRef(hashes).drop_front(numTypes);
+
     Optional<uint32_t> endPrecomp;
     // Merge TPI first, because the IPI stream will reference type indices.
     if (auto err =
@@ -458,8 +581,6 @@ Expected<const CVIndexMap &> PDBLinker::maybeMergeTypeServerPDB(ObjFile *file) {
 
     // Merge IPI.
     if (maybeIpi) {
-      auto ipiHashes =
-          GloballyHashedType::hashIds(maybeIpi->typeArray(), tpiHashes);
       if (auto err =
               mergeIdRecords(tMerger.globalIDTable, indexMap.tpiMap,
                              indexMap.ipiMap, maybeIpi->typeArray(), ipiHashes))
@@ -565,7 +686,7 @@ Expected<const CVIndexMap &> PDBLinker::aquirePrecompObj(ObjFile *file) {
         precompFileName.str(),
         make_error<pdb::PDBError>(pdb::pdb_error_code::external_cmdline_ref));
 
-  addObjFile(precompFile, &indexMap);
+  addObjFileTypes(precompFile, &indexMap);
 
   if (!precompFile->pchSignature)
     fatal(precompFile->getName() + " is not a precompiled headers object");
@@ -587,7 +708,201 @@ static bool remapTypeIndex(TypeIndex &ti, ArrayRef<TypeIndex> typeIndexMap) {
   return true;
 }
 
-static void remapTypesInSymbolRecord(ObjFile *file, SymbolKind symKind,
+static bool isIdRecord(TypeLeafKind k) {
+  switch (k) {
+  case TypeLeafKind::LF_FUNC_ID:
+  case TypeLeafKind::LF_MFUNC_ID:
+  case TypeLeafKind::LF_STRING_ID:
+  case TypeLeafKind::LF_SUBSTR_LIST:
+  case TypeLeafKind::LF_BUILDINFO:
+  case TypeLeafKind::LF_UDT_SRC_LINE:
+  case TypeLeafKind::LF_UDT_MOD_SRC_LINE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static TypeLeafKind getRecordKind(ArrayRef<uint8_t> record) {
+  return static_cast<TypeLeafKind>(
+      reinterpret_cast<const RecordPrefix *>(record.data())->RecordKind);
+}
+
+namespace {
+// A lock-free hash table from global type hashes to the first record with
+// the hash, in object file order. An entry is the source index plus one in
+// the upper 32 bits and the record index in the lower 32 bits, so the first
+// record has the smallest entry and 0 marks an empty slot.
+class GHashTable {
+public:
+  GHashTable(ArrayRef<GHashSource> sources, size_t numRecords)
+      : sources(sources), slots(PowerOf2Ceil(numRecords * 2 + 1)) {}
+
+  static uint64_t makeEntry(size_t srcIdx, size_t recIdx) {
+    return ((uint64_t)(srcIdx + 1) << 32) | recIdx;
+  }
+
+  void insert(GloballyHashedType hash, uint64_t entry) {
+    for (size_t i = getStartSlot(hash);; i = (i + 1) & (slots.size() - 1)) {
+      uint64_t old = slots[i].load(std::memory_order_relaxed);
+      if (old == 0 && slots[i].compare_exchange_strong(old, entry))
+        return;
+      if (!(getHash(old) == hash))
+        continue;
+      while (entry < old && !slots[i].compare_exchange_weak(old, entry))
+        ;
+      return;
+    }
+  }
+
+  uint64_t lookup(GloballyHashedType hash) const {
+    for (size_t i = getStartSlot(hash);; i = (i + 1) & (slots.size() - 1)) {
+      uint64_t entry = slots[i].load(std::memory_order_relaxed);
+      assert(entry && "hash not in table");
+      if (getHash(entry) == hash)
+        return entry;
+    }
+  }
+
+private:
+  size_t getStartSlot(GloballyHashedType hash) const {
+    uint64_t h;
+    memcpy(&h, hash.Hash.data(), sizeof(h));
+    return h & (slots.size() - 1);
+  }
+
+  GloballyHashedType getHash(uint64_t entry) const {
+    return sources[(entry >> 32) - 1].hashes[(uint32_t)entry];
+  }
+
+  ArrayRef<GHashSource> sources;
+  std::vector<std::atomic<uint64_t>> slots;
+};
+} // namespace
+
+// A serial merge looks up every record of every object in the destination
+// type table, although most records are duplicates. Instead, we find the
+// first record with each global hash with a concurrent hash table, so that
+// only those records need to be added to the destination table serially,
+// and remap them in parallel.
+void PDBLinker::findGHashLeaders() {
+  ScopedTimer t(typeMergingTimer);
+
+  for (ObjFile *file : ObjFile::instances) {
+    if (!file->debugTypesObj || file->debugTypesObj->kind != TpiSource::Regular)
+      continue;
+    ghashSources.emplace_back();
+    ghashSources.back().file = file;
+  }
+
+  // Split the type streams into records and compute or load their hashes.
+  // Objects that we cannot handle here are left to mergeDebugT().
+  parallelForEach(ghashSources, [&](GHashSource &src) {
+    CVTypeArray &types = *src.file->debugTypes;
+    for (const CVType &type : types)
+      src.records.push_back(type.RecordData);
+    if (Optional<ArrayRef<uint8_t>> debugH = getDebugH(src.file)) {
+      src.hashes = getHashesFromDebugH(*debugH);
+    } else {
+      src.ownedHashes = GloballyHashedType::hashTypes(types);
+      src.hashes = src.ownedHashes;
+    }
+  });
+  llvm::erase_if(ghashSources, [](const GHashSource &src) {
+    return src.records.size() != src.hashes.size() ||
+           src.records.size() >= UINT32_MAX;
+  });
+  if (ghashSources.empty())
+    return;
+
+  size_t numRecords = 0;
+  for (size_t i = 0, e = ghashSources.size(); i != e; ++i) {
+    numRecords += ghashSources[i].records.size();
+    ghashSourceIndices[ghashSources[i].file] = i;
+  }
+
+  GHashTable table(ghashSources, numRecords);
+  parallelForEachN(0, ghashSources.size(), [&](size_t i) {
+    GHashSource &src = ghashSources[i];
+    for (size_t j = 0, e = src.hashes.size(); j < e; ++j)
+      table.insert(src.hashes[j], GHashTable::makeEntry(i, j));
+  });
+
+  parallelForEach(ghashSources, [&](GHashSource &src) {
+    src.leaders.resize(src.records.size());
+    for (size_t j = 0, e = src.records.size(); j < e; ++j)
+      src.leaders[j] = table.lookup(src.hashes[j]);
+  });
+}
+
+// Objects using precompiled headers or a type server are merged serially in
+// between, so the destination tables may already have a leader's hash. In
+// that case, the leader gets the existing index and is not copied.
+const CVIndexMap &PDBLinker::addGHashLeaders(size_t srcIdx) {
+  GHashSource &src = ghashSources[srcIdx];
+  src.destIndices.resize(src.records.size());
+  src.destRecords.resize(src.records.size());
+  for (size_t j = 0, e = src.records.size(); j < e; ++j) {
+    if (src.leaders[j] != GHashTable::makeEntry(srcIdx, j))
+      continue;
+    ArrayRef<uint8_t> rec = src.records[j];
+    GlobalTypeTableBuilder &dest = isIdRecord(getRecordKind(rec))
+                                       ? tMerger.globalIDTable
+                                       : tMerger.globalTypeTable;
+    src.destIndices[j] = dest.insertRecordAs(
+        src.hashes[j], rec.size(), [&](MutableArrayRef<uint8_t> data) {
+          memcpy(data.data(), rec.data(), rec.size());
+          src.destRecords[j] = data;
+          return data;
+        });
+  }
+
+  // The map is filled in by remapGHashSources() before it is used to merge
+  // symbols.
+  return src.indexMap;
+}
+
+void PDBLinker::remapGHashSources() {
+  ScopedTimer t(typeMergingTimer);
+
+  // A record's leader is in the same object or in an earlier one, so all
+  // leaders have been added by now.
+  parallelForEach(ghashSources, [&](GHashSource &src) {
+    SmallVectorImpl<TypeIndex> &tpiMap = src.indexMap.tpiMap;
+    tpiMap.resize(src.records.size());
+    for (size_t j = 0, e = src.records.size(); j < e; ++j) {
+      uint64_t leader = src.leaders[j];
+      tpiMap[j] =
+          ghashSources[(leader >> 32) - 1].destIndices[(uint32_t)leader];
+    }
+  });
+
+  // Rewrite the type indices in the copies.
+  parallelForEach(ghashSources, [&](GHashSource &src) {
+    SmallVector<TiReference, 32> refs;
+    for (MutableArrayRef<uint8_t> data : src.destRecords) {
+      if (data.empty())
+        continue;
+      refs.clear();
+      discoverTypeIndices(data, refs);
+      MutableArrayRef<uint8_t> contents = data.drop_front(sizeof(RecordPrefix));
+      for (const TiReference &ref : refs) {
+        if (contents.size() < ref.Offset + ref.Count * sizeof(TypeIndex))
+          continue;
+        MutableArrayRef<TypeIndex> tis(
+            reinterpret_cast<TypeIndex *>(contents.data() + ref.Offset),
+            ref.Count);
+        for (TypeIndex &ti : tis)
+          if (!remapTypeIndex(ti, src.indexMap.tpiMap))
+            ti = TypeIndex(SimpleTypeKind::NotTranslated);
+      }
+    }
+  });
+}
+
+// Returns false if the record is too short for its type index references.
+static bool remapTypesInSymbolRecord(DebugSHandler &handler, ObjFile *file,
+                                     SymbolKind symKind,
                                      MutableArrayRef<uint8_t> recordBytes,
                                      const CVIndexMap &indexMap,
                                      ArrayRef<TiReference> typeRefs) {
@@ -595,8 +910,10 @@ static void remapTypesInSymbolRecord(ObjFile *file, SymbolKind symKind,
       recordBytes.drop_front(sizeof(RecordPrefix));
   for (const TiReference &ref : typeRefs) {
     unsigned byteSize = ref.Count * sizeof(TypeIndex);
-    if (contents.size() < ref.Offset + byteSize)
-      fatal("symbol record too short");
+    if (contents.size() < ref.Offset + byteSize) {
+      handler.addFatal("symbol record too short");
+      return false;
+    }
 
     // This can be an item index or a type index. Choose the appropriate map.
     ArrayRef<TypeIndex> typeOrItemMap = indexMap.tpiMap;
@@ -608,14 +925,16 @@ static void remapTypesInSymbolRecord(ObjFile *file, SymbolKind symKind,
         reinterpret_cast<TypeIndex *>(contents.data() + ref.Offset), ref.Count);
     for (TypeIndex &ti : tIs) {
       if (!remapTypeIndex(ti, typeOrItemMap)) {
-        log("ignoring symbol record of kind 0x" + utohexstr(symKind) + " in " +
-            file->getName() + " with bad " + (isItemIndex ? "item" : "type") +
-            " index 0x" + utohexstr(ti.getIndex()));
+        handler.addLog("ignoring symbol record of kind 0x" +
+                       utohexstr(symKind) + " in " + file->getName() +
+                       " with bad " + (isItemIndex ? "item" : "type") +
+                       " index 0x" + utohexstr(ti.getIndex()));
         ti = TypeIndex(SimpleTypeKind::NotTranslated);
         continue;
       }
     }
   }
+  return true;
 }
 
 static void
@@ -629,7 +948,8 @@ recordStringTableReferenceAtOffset(MutableArrayRef<uint8_t> contents,
 }
 
 static void
-recordStringTableReferences(SymbolKind kind, MutableArrayRef<uint8_t> contents,
+recordStringTableReferences(DebugSHandler &handler, SymbolKind kind,
+                            MutableArrayRef<uint8_t> contents,
                             std::vector<ulittle32_t *> &strTableRefs) {
   // For now we only handle S_FILESTATIC, but we may need the same logic for
   // S_DEFRANGE and S_DEFRANGE_SUBFIELD.  However, I cannot seem to generate any
@@ -642,8 +962,8 @@ recordStringTableReferences(SymbolKind kind, MutableArrayRef<uint8_t> contents,
     break;
   case SymbolKind::S_DEFRANGE:
   case SymbolKind::S_DEFRANGE_SUBFIELD:
-    log("Not fixing up string table reference in S_DEFRANGE / "
-        "S_DEFRANGE_SUBFIELD record");
+    handler.addLog("Not fixing up string table reference in S_DEFRANGE / "
+                   "S_DEFRANGE_SUBFIELD record");
     break;
   default:
     break;
@@ -744,14 +1064,14 @@ static void scopeStackOpen(SmallVectorImpl<SymbolScope> &stack,
   stack.push_back(s);
 }
 
-static void scopeStackClose(SmallVectorImpl<SymbolScope> &stack,
-                            uint32_t curOffset, InputFile *file) {
-  if (stack.empty()) {
-    warn("symbol scopes are not balanced in " + file->getName());
-    return;
-  }
+// Returns false if there is no open scope to close.
+static bool scopeStackClose(SmallVectorImpl<SymbolScope> &stack,
+                            uint32_t curOffset) {
+  if (stack.empty())
+    return false;
   SymbolScope s = stack.pop_back_val();
   s.openingRecord->ptrEnd = curOffset;
+  return true;
 }
 
 static bool symbolGoesInModuleStream(const CVSymbol &sym, bool isGlobalScope) {
@@ -828,9 +1148,7 @@ static void addGlobalSymbol(pdb::GSIStreamBuilder &builder, uint16_t modIndex,
   }
 }
 
-void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
-                                   std::vector<ulittle32_t *> &stringTableRefs,
-                                   BinaryStreamRef symData) {
+void DebugSHandler::mergeSymbolRecords(BinaryStreamRef symData) {
   ArrayRef<uint8_t> symsBuffer;
   cantFail(symData.readBytes(0, symData.getLength(), symsBuffer));
   SmallVector<SymbolScope, 4> scopes;
@@ -851,7 +1169,7 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
   // If any of the symbol record lengths was corrupt, ignore them all, warn
   // about it, and move on.
   if (ec) {
-    warn("corrupt symbol records in " + file->getName());
+    addWarning("corrupt symbol records in " + file.getName());
     consumeError(std::move(ec));
     return;
   }
@@ -868,9 +1186,9 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
   }
 
   // Iterate again, this time doing the real work.
-  unsigned curSymOffset = file->moduleDBI->getNextSymbolOffset();
+  unsigned curSymOffset = file.moduleDBI->getNextSymbolOffset();
   ArrayRef<uint8_t> bulkSymbols;
-  cantFail(forEachCodeViewRecord<CVSymbol>(
+  ec = forEachCodeViewRecord<CVSymbol>(
       symsBuffer, [&](CVSymbol sym) -> llvm::Error {
         // Align the record if required.
         MutableArrayRef<uint8_t> recordBytes;
@@ -888,39 +1206,39 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
         // know where they are.
         SmallVector<TiReference, 32> typeRefs;
         if (!discoverTypeIndicesInSymbol(sym, typeRefs)) {
-          log("ignoring unknown symbol record with kind 0x" +
-              utohexstr(sym.kind()));
+          addLog("ignoring unknown symbol record with kind 0x" +
+                 utohexstr(sym.kind()));
           return Error::success();
         }
 
         // Re-map all the type index references.
-        remapTypesInSymbolRecord(file, sym.kind(), recordBytes, indexMap,
-                                 typeRefs);
+        if (!remapTypesInSymbolRecord(*this, &file, sym.kind(), recordBytes,
+                                      indexMap, typeRefs))
+          return make_error<CodeViewError>(cv_error_code::corrupt_record);
 
         // An object file may have S_xxx_ID symbols, but these get converted to
         // "real" symbols in a PDB.
-        translateIdSymbols(recordBytes, tMerger.getIDTable());
+        translateIdSymbols(recordBytes, linker.tMerger.getIDTable());
         sym = CVSymbol(recordBytes);
 
         // If this record refers to an offset in the object file's string table,
         // add that item to the global PDB string table and re-write the index.
-        recordStringTableReferences(sym.kind(), recordBytes, stringTableRefs);
+        recordStringTableReferences(*this, sym.kind(), recordBytes,
+                                    stringTableReferences);
 
         // Fill in "Parent" and "End" fields by maintaining a stack of scopes.
         if (symbolOpensScope(sym.kind()))
           scopeStackOpen(scopes, curSymOffset, sym);
         else if (symbolEndsScope(sym.kind()))
-          scopeStackClose(scopes, curSymOffset, file);
+          if (!scopeStackClose(scopes, curSymOffset))
+            addWarning("symbol scopes are not balanced in " + file.getName());
 
         // Add the symbol to the globals stream if necessary.  Do this before
         // adding the symbol to the module since we may need to get the next
         // symbol offset, and writing to the module's symbol stream will update
         // that offset.
-        if (symbolGoesInGlobalsStream(sym, scopes.empty())) {
-          addGlobalSymbol(builder.getGsiBuilder(),
-                          file->moduleDBI->getModuleIndex(), curSymOffset, sym);
-          ++globalSymbols;
-        }
+        if (symbolGoesInGlobalsStream(sym, scopes.empty()))
+          globalSymbols.push_back({curSymOffset, sym});
 
         if (symbolGoesInModuleStream(sym, scopes.empty())) {
           // Add symbols to the module in bulk. If this symbol is contiguous
@@ -930,17 +1248,23 @@ void PDBLinker::mergeSymbolRecords(ObjFile *file, const CVIndexMap &indexMap,
             bulkSymbols = makeArrayRef(bulkSymbols.data(),
                                        bulkSymbols.size() + sym.length());
           } else {
-            file->moduleDBI->addSymbolsInBulk(bulkSymbols);
+            file.moduleDBI->addSymbolsInBulk(bulkSymbols);
             bulkSymbols = recordBytes;
           }
           curSymOffset += sym.length();
-          ++moduleSymbols;
+          ++numModuleSymbols;
         }
         return Error::success();
-      }));
+      });
+
+  // The error has been recorded by remapTypesInSymbolRecord().
+  if (ec) {
+    consumeError(std::move(ec));
+    return;
+  }
 
   // Add any remaining symbols we've accumulated.
-  file->moduleDBI->addSymbolsInBulk(bulkSymbols);
+  file.moduleDBI->addSymbolsInBulk(bulkSymbols);
 }
 
 // Allocate memory for a .debug$S / .debug$F section and relocate it.
@@ -996,10 +1320,11 @@ void DebugSHandler::handleDebugS(lld::coff::SectionChunk &debugS) {
   DebugSubsectionArray subsections;
 
   ArrayRef<uint8_t> relocatedDebugContents = SectionChunk::consumeDebugMagic(
-      relocateDebugChunk(linker.alloc, debugS), debugS.getSectionName());
+      relocateDebugChunk(alloc, debugS), debugS.getSectionName());
 
   BinaryStreamReader reader(relocatedDebugContents, support::little);
-  exitOnErr(reader.readArray(subsections, relocatedDebugContents.size()));
+  if (!check(reader.readArray(subsections, relocatedDebugContents.size())))
+    return;
 
   for (const DebugSubsectionRecord &ss : subsections) {
     // Ignore subsections with the 'ignore' bit. Some versions of the Visual C++
@@ -1011,13 +1336,15 @@ void DebugSHandler::handleDebugS(lld::coff::SectionChunk &debugS) {
     case DebugSubsectionKind::StringTable: {
       assert(!cVStrTab.valid() &&
              "Encountered multiple string table subsections!");
-      exitOnErr(cVStrTab.initialize(ss.getRecordData()));
+      if (!check(cVStrTab.initialize(ss.getRecordData())))
+        return;
       break;
     }
     case DebugSubsectionKind::FileChecksums:
       assert(!checksums.valid() &&
              "Encountered multiple checksum subsections!");
-      exitOnErr(checksums.initialize(ss.getRecordData()));
+      if (!check(checksums.initialize(ss.getRecordData())))
+        return;
       break;
     case DebugSubsectionKind::Lines:
       // We can add the relocated line table directly to the PDB without
@@ -1027,20 +1354,23 @@ void DebugSHandler::handleDebugS(lld::coff::SectionChunk &debugS) {
     case DebugSubsectionKind::InlineeLines:
       assert(!inlineeLines.valid() &&
              "Encountered multiple inlinee lines subsections!");
-      exitOnErr(inlineeLines.initialize(ss.getRecordData()));
+      if (!check(inlineeLines.initialize(ss.getRecordData())))
+        return;
       break;
     case DebugSubsectionKind::FrameData: {
       // We need to re-write string table indices here, so save off all
       // frame data subsections until we've processed the entire list of
       // subsections so that we can be sure we have the string table.
       DebugFrameDataSubsectionRef fds;
-      exitOnErr(fds.initialize(ss.getRecordData()));
+      if (!check(fds.initialize(ss.getRecordData())))
+        return;
       newFpoFrames.push_back(std::move(fds));
       break;
     }
     case DebugSubsectionKind::Symbols: {
-      linker.mergeSymbolRecords(&file, indexMap, stringTableReferences,
-                                ss.getRecordData());
+      mergeSymbolRecords(ss.getRecordData());
+      if (failed)
+        return;
       break;
     }
 
@@ -1062,8 +1392,9 @@ void DebugSHandler::handleDebugS(lld::coff::SectionChunk &debugS) {
       break;
 
     default:
-      warn("ignoring unknown debug$S subsection kind 0x" +
-           utohexstr(uint32_t(ss.kind())) + " in file " + toString(&file));
+      addWarning("ignoring unknown debug$S subsection kind 0x" +
+                 utohexstr(uint32_t(ss.kind())) + " in file " +
+                 toString(&file));
       break;
     }
   }
@@ -1114,9 +1445,53 @@ DebugSHandler::mergeInlineeLines(DebugChecksumsSubsection *newChecksums) {
   return newInlineeLines;
 }
 
+void DebugSHandler::addLog(const Twine &msg) {
+  if (errorHandler().verbose)
+    diagnostics.push_back({Log, msg.str()});
+}
+
+void DebugSHandler::addWarning(const Twine &msg) {
+  diagnostics.push_back({Warning, msg.str()});
+}
+
+void DebugSHandler::addFatal(const Twine &msg) {
+  diagnostics.push_back({Fatal, msg.str()});
+  failed = true;
+}
+
+bool DebugSHandler::check(Error e) {
+  if (!e)
+    return true;
+  addFatal(toString(std::move(e)));
+  return false;
+}
+
 void DebugSHandler::finish() {
+  for (std::pair<DiagnosticKind, std::string> &d : diagnostics) {
+    switch (d.first) {
+    case Log:
+      log(d.second);
+      break;
+    case Warning:
+      warn(d.second);
+      break;
+    case Fatal:
+      fatal(d.second);
+    }
+  }
+
   pdb::DbiStreamBuilder &dbiBuilder = linker.builder.getDbiBuilder();
 
+  for (const object::FpoData &fd : oldFpoData)
+    dbiBuilder.addOldFpoData(fd);
+
+  uint16_t modIndex = file.moduleDBI->getModuleIndex();
+  for (std::pair<uint32_t, CVSymbol> &p : globalSymbols)
+    addGlobalSymbol(linker.builder.getGsiBuilder(), modIndex, p.first,
+                    p.second);
+  linker.globalSymbols += globalSymbols.size();
+  linker.moduleSymbols += numModuleSymbols;
+
   // We should have seen all debug subsections across the entire object file now
   // which means that if a StringTable subsection and Checksums subsection were
   // present, now is the time to handle them.
@@ -1166,7 +1541,7 @@ void DebugSHandler::finish() {
   file.moduleDBI->addDebugSubsection(std::move(newChecksums));
 }
 
-void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
+void PDBLinker::addObjFileTypes(ObjFile *file, CVIndexMap *externIndexMap) {
   if (file->mergedIntoPDB)
     return;
   file->mergedIntoPDB = true;
@@ -1175,9 +1550,12 @@ void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
   // type information, file checksums, and the string table.  Add type info to
   // the PDB first, so that we can get the map from object file type and item
   // indices to PDB type and item indices.
-  CVIndexMap objectIndexMap;
-  auto indexMapResult =
-      mergeDebugT(file, externIndexMap ? externIndexMap : &objectIndexMap);
+  CVIndexMap *objectIndexMap = externIndexMap;
+  if (!objectIndexMap) {
+    objectIndexMaps.emplace_back();
+    objectIndexMap = &objectIndexMaps.back();
+  }
+  auto indexMapResult = mergeDebugT(file, objectIndexMap);
 
   // If the .debug$T sections fail to merge, assume there is no debug info.
   if (!indexMapResult) {
@@ -1191,17 +1569,19 @@ void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
     return;
   }
 
-  ScopedTimer t(symbolMergingTimer);
+  modules.push_back(make_unique<DebugSHandler>(*this, *file, *indexMapResult));
+}
 
-  pdb::DbiStreamBuilder &dbiBuilder = builder.getDbiBuilder();
-  DebugSHandler dsh(*this, *file, *indexMapResult);
+void DebugSHandler::handleDebugSections() {
   // Now do all live .debug$S and .debug$F sections.
-  for (SectionChunk *debugChunk : file->getDebugChunks()) {
+  for (SectionChunk *debugChunk : file.getDebugChunks()) {
     if (!debugChunk->live || debugChunk->getSize() == 0)
       continue;
 
     if (debugChunk->getSectionName() == ".debug$S") {
-      dsh.handleDebugS(*debugChunk);
+      handleDebugS(*debugChunk);
+      if (failed)
+        return;
       continue;
     }
 
@@ -1212,18 +1592,15 @@ void PDBLinker::addObjFile(ObjFile *file, CVIndexMap *externIndexMap) {
       FixedStreamArray<object::FpoData> fpoRecords;
       BinaryStreamReader reader(relocatedDebugContents, support::little);
       uint32_t count = relocatedDebugContents.size() / sizeof(object::FpoData);
-      exitOnErr(reader.readArray(fpoRecords, count));
+      if (!check(reader.readArray(fpoRecords, count)))
+        return;
 
       // These are already relocated and don't refer to the string table, so we
       // can just copy it.
-      for (const object::FpoData &fd : fpoRecords)
-        dbiBuilder.addOldFpoData(fd);
+      oldFpoData.insert(oldFpoData.end(), fpoRecords.begin(), fpoRecords.end());
       continue;
     }
   }
-
-  // Do any post-processing now that all .debug$S sections have been processed.
-  dsh.finish();
 }
 
 // Add a module descriptor for every object file. We need to put an absolute
@@ -1282,8 +1659,25 @@ void PDBLinker::addObjectsToPDB() {
 
   createModuleDBI(builder);
 
+  if (config->debugGHashes)
+    findGHashLeaders();
+
   for (ObjFile *file : ObjFile::instances)
-    addObjFile(file);
+    addObjFileTypes(file);
+
+  if (config->debugGHashes)
+    remapGHashSources();
+
+  // Module streams are independent of each other, so we can fill them in
+  // parallel. The PDB-wide tables are then updated in the original order.
+  {
+    ScopedTimer t(symbolMergingTimer);
+    parallelForEach(modules, [](std::unique_ptr<DebugSHandler> &dsh) {
+      dsh->handleDebugSections();
+    });
+    for (std::unique_ptr<DebugSHandler> &dsh : modules)
+      dsh->finish();
+  }
 
   builder.getStringTableBuilder().setStrings(pdbStrTab);
   t1.stop();
@@ -1588,7 +1982,7 @@ void PDBLinker::addImportFilesToPDB(ArrayRef<OutputSection *> outputSections) {
 
     newSym = codeview::SymbolSerializer::writeOneSymbol(es, alloc,
                                                         CodeViewContainer::Pdb);
-    scopeStackClose(scopes, mod->getNextSymbolOffset(), file);
+    scopeStackClose(scopes, mod->getNextSymbolOffset());
 
     mod->addSymbol(newSym);
 
@@ -1712,88 +2106,170 @@ static uint32_t getSecrelReloc() {
   }
 }
 
-// Try to find a line table for the given offset Addr into the given chunk C.
-// If a line table was found, the line table, the string and checksum tables
-// that are used to interpret the line table, and the offset of Addr in the line
-// table are stored in the output arguments. Returns whether a line table was
-// found.
-static bool findLineTable(const SectionChunk *c, uint32_t addr,
-                          DebugStringTableSubsectionRef &cVStrTab,
-                          DebugChecksumsSubsectionRef &checksums,
-                          DebugLinesSubsectionRef &lines,
-                          uint32_t &offsetInLinetable) {
-  ExitOnError exitOnErr;
+// The CodeView line tables of an object file, indexed by the chunk and the
+// range of offsets they describe. Diagnostics may look up the source location
+// of many addresses in the same file, so the .debug$S sections of a file are
+// parsed only once. File names are looked up only for the lines that are
+// asked for, so that a bad entry doesn't affect other lookups.
+struct coff::LineTableIndex {
+  struct Table {
+    const SectionChunk *chunk;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t firstLine;
+    uint32_t numLines;
+  };
+
+  struct Line {
+    uint32_t offset;
+    uint32_t line;
+    uint32_t nameIndex;
+  };
+
+  DebugStringTableSubsectionRef cVStrTab;
+  DebugChecksumsSubsectionRef checksums;
+  // Sorted by chunk and then by begin.
+  std::vector<Table> tables;
+  // The lines of each table, in the order they appear in the table.
+  std::vector<Line> lines;
+};
+
+// Relocations against discarded sections are reported while sections are
+// written in parallel, so creating indexes is serialized.
+static std::mutex lineTableMu;
+
+// Line tables that cannot be read are left out of the index. They are only
+// used for diagnostics, which are better off without a location than not
+// reported at all.
+static void buildLineTableIndex(ObjFile *file, LineTableIndex &index) {
   uint32_t secrelReloc = getSecrelReloc();
 
-  for (SectionChunk *dbgC : c->file->getDebugChunks()) {
+  // The string table and the file checksums used to interpret the line tables
+  // may be in a different .debug$S section than the line tables themselves.
+  std::vector<std::pair<SectionChunk *, DebugSubsectionRecord>> lineSubsections;
+
+  for (SectionChunk *dbgC : file->getDebugChunks()) {
     if (dbgC->getSectionName() != ".debug$S")
       continue;
 
-    // Build a mapping of SECREL relocations in dbgC that refer to `c`.
-    DenseMap<uint32_t, uint32_t> secrels;
-    for (const coff_relocation &r : dbgC->getRelocs()) {
-      if (r.Type != secrelReloc)
-        continue;
-
-      if (auto *s = dyn_cast_or_null<DefinedRegular>(
-              c->file->getSymbols()[r.SymbolTableIndex]))
-        if (s->getChunk() == c)
-          secrels[r.VirtualAddress] = s->getValue();
-    }
-
     ArrayRef<uint8_t> contents =
         SectionChunk::consumeDebugMagic(dbgC->getContents(), ".debug$S");
     DebugSubsectionArray subsections;
     BinaryStreamReader reader(contents, support::little);
-    exitOnErr(reader.readArray(subsections, contents.size()));
+    if (Error e = reader.readArray(subsections, contents.size())) {
+      consumeError(std::move(e));
+      continue;
+    }
 
     for (const DebugSubsectionRecord &ss : subsections) {
       switch (ss.kind()) {
-      case DebugSubsectionKind::StringTable: {
-        assert(!cVStrTab.valid() &&
+      case DebugSubsectionKind::StringTable:
+        assert(!index.cVStrTab.valid() &&
                "Encountered multiple string table subsections!");
-        exitOnErr(cVStrTab.initialize(ss.getRecordData()));
+        if (Error e = index.cVStrTab.initialize(ss.getRecordData()))
+          consumeError(std::move(e));
         break;
-      }
       case DebugSubsectionKind::FileChecksums:
-        assert(!checksums.valid() &&
+        assert(!index.checksums.valid() &&
                "Encountered multiple checksum subsections!");
-        exitOnErr(checksums.initialize(ss.getRecordData()));
+        if (Error e = index.checksums.initialize(ss.getRecordData()))
+          consumeError(std::move(e));
         break;
-      case DebugSubsectionKind::Lines: {
-        ArrayRef<uint8_t> bytes;
-        auto ref = ss.getRecordData();
-        exitOnErr(ref.readLongestContiguousChunk(0, bytes));
-        size_t offsetInDbgC = bytes.data() - dbgC->getContents().data();
-
-        // Check whether this line table refers to C.
-        auto i = secrels.find(offsetInDbgC);
-        if (i == secrels.end())
-          break;
-
-        // Check whether this line table covers Addr in C.
-        DebugLinesSubsectionRef linesTmp;
-        exitOnErr(linesTmp.initialize(BinaryStreamReader(ref)));
-        uint32_t offsetInC = i->second + linesTmp.header()->RelocOffset;
-        if (addr < offsetInC || addr >= offsetInC + linesTmp.header()->CodeSize)
-          break;
-
-        assert(!lines.header() &&
-               "Encountered multiple line tables for function!");
-        exitOnErr(lines.initialize(BinaryStreamReader(ref)));
-        offsetInLinetable = addr - offsetInC;
+      case DebugSubsectionKind::Lines:
+        lineSubsections.push_back({dbgC, ss});
         break;
-      }
       default:
         break;
       }
+    }
+  }
+
+  if (!index.cVStrTab.valid() || !index.checksums.valid())
+    return;
 
-      if (cVStrTab.valid() && checksums.valid() && lines.header())
-        return true;
+  // Map the SECREL relocations of each .debug$S section to the chunks and
+  // offsets they refer to.
+  DenseMap<std::pair<const SectionChunk *, uint32_t>,
+           std::pair<const SectionChunk *, uint32_t>>
+      secrels;
+  for (SectionChunk *dbgC : file->getDebugChunks()) {
+    if (dbgC->getSectionName() != ".debug$S")
+      continue;
+    for (const coff_relocation &r : dbgC->getRelocs()) {
+      if (r.Type != secrelReloc)
+        continue;
+      if (auto *s = dyn_cast_or_null<DefinedRegular>(
+              file->getSymbols()[r.SymbolTableIndex]))
+        secrels[{dbgC, r.VirtualAddress}] = {s->getChunk(), s->getValue()};
     }
   }
 
-  return false;
+  for (auto &entry : lineSubsections) {
+    SectionChunk *dbgC = entry.first;
+    BinaryStreamRef ref = entry.second.getRecordData();
+    ArrayRef<uint8_t> bytes;
+    if (Error e = ref.readLongestContiguousChunk(0, bytes)) {
+      consumeError(std::move(e));
+      continue;
+    }
+    uint32_t offsetInDbgC = bytes.data() - dbgC->getContents().data();
+
+    auto it = secrels.find({dbgC, offsetInDbgC});
+    if (it == secrels.end())
+      continue;
+
+    DebugLinesSubsectionRef lines;
+    if (Error e = lines.initialize(BinaryStreamReader(ref))) {
+      consumeError(std::move(e));
+      continue;
+    }
+    uint32_t offsetInC = it->second.second + lines.header()->RelocOffset;
+
+    LineTableIndex::Table table;
+    table.chunk = it->second.first;
+    table.begin = offsetInC;
+    table.end = offsetInC + lines.header()->CodeSize;
+    table.firstLine = index.lines.size();
+    for (LineColumnEntry &lce : lines)
+      for (const LineNumberEntry &ln : lce.LineNumbers)
+        index.lines.push_back(
+            {ln.Offset, LineInfo(ln.Flags).getStartLine(), lce.NameIndex});
+    table.numLines = index.lines.size() - table.firstLine;
+    index.tables.push_back(table);
+  }
+
+  llvm::stable_sort(index.tables, [](const LineTableIndex::Table &a,
+                                     const LineTableIndex::Table &b) {
+    return std::tie(a.chunk, a.begin) < std::tie(b.chunk, b.begin);
+  });
+}
+
+static const LineTableIndex &getLineTableIndex(ObjFile *file) {
+  std::lock_guard<std::mutex> lock(lineTableMu);
+  if (!file->lineTableIndex) {
+    file->lineTableIndex = make<LineTableIndex>();
+    buildLineTableIndex(file, *file->lineTableIndex);
+  }
+  return *file->lineTableIndex;
+}
+
+// This is called before sections are written, so no other thread looks up
+// line tables while the indexes are filled in in parallel.
+void coff::buildLineTableIndexes(ArrayRef<ObjFile *> files) {
+  std::vector<ObjFile *> pending;
+  {
+    std::lock_guard<std::mutex> lock(lineTableMu);
+    for (ObjFile *file : files) {
+      if (file->lineTableIndex)
+        continue;
+      file->lineTableIndex = make<LineTableIndex>();
+      pending.push_back(file);
+    }
+  }
+
+  parallelForEach(pending, [](ObjFile *file) {
+    buildLineTableIndex(file, *file->lineTableIndex);
+  });
 }
 
 // Use CodeView line tables to resolve a file and line number for the given
@@ -1801,36 +2277,33 @@ static bool findLineTable(const SectionChunk *c, uint32_t addr,
 // not found.
 std::pair<StringRef, uint32_t> coff::getFileLine(const SectionChunk *c,
                                                  uint32_t addr) {
-  ExitOnError exitOnErr;
-
-  DebugStringTableSubsectionRef cVStrTab;
-  DebugChecksumsSubsectionRef checksums;
-  DebugLinesSubsectionRef lines;
-  uint32_t offsetInLinetable;
-
-  if (!findLineTable(c, addr, cVStrTab, checksums, lines, offsetInLinetable))
+  const LineTableIndex &index = getLineTableIndex(c->file);
+
+  // Find the line table covering Addr in C.
+  auto it = llvm::upper_bound(
+      index.tables, std::make_pair(c, addr),
+      [](std::pair<const SectionChunk *, uint32_t> key,
+         const LineTableIndex::Table &t) {
+        return std::tie(key.first, key.second) < std::tie(t.chunk, t.begin);
+      });
+  if (it == index.tables.begin())
+    return {"", 0};
+  --it;
+  if (it->chunk != c || addr >= it->end || it->numLines == 0)
     return {"", 0};
 
-  Optional<uint32_t> nameIndex;
-  Optional<uint32_t> lineNumber;
-  for (LineColumnEntry &entry : lines) {
-    for (const LineNumberEntry &ln : entry.LineNumbers) {
-      LineInfo li(ln.Flags);
-      if (ln.Offset > offsetInLinetable) {
-        if (!nameIndex) {
-          nameIndex = entry.NameIndex;
-          lineNumber = li.getStartLine();
-        }
-        StringRef filename =
-            exitOnErr(getFileName(cVStrTab, checksums, *nameIndex));
-        return {filename, *lineNumber};
-      }
-      nameIndex = entry.NameIndex;
-      lineNumber = li.getStartLine();
-    }
+  // Find the last line that starts at or before Addr. If Addr precedes all
+  // lines, use the first one.
+  ArrayRef<LineTableIndex::Line> lines =
+      makeArrayRef(index.lines).slice(it->firstLine, it->numLines);
+  uint32_t offsetInLinetable = addr - it->begin;
+  const LineTableIndex::Line *found = &lines.front();
+  for (const LineTableIndex::Line &l : lines) {
+    if (l.offset > offsetInLinetable)
+      break;
+    found = &l;
   }
-  if (!nameIndex)
-    return {"", 0};
-  StringRef filename = exitOnErr(getFileName(cVStrTab, checksums, *nameIndex));
-  return {filename, *lineNumber};
+  StringRef fileName = exitOnErr(
+      getFileName(index.cVStrTab, index.checksums, found->nameIndex));
+  return {fileName, found->line};
 }
@@ -20,6 +20,7 @@ union DebugInfo;
 
 namespace lld {
 namespace coff {
+class ObjFile;
 class OutputSection;
 class SectionChunk;
 class SymbolTable;
@@ -31,6 +32,10 @@ void createPDB(SymbolTable *symtab,
 
 std::pair<llvm::StringRef, uint32_t> getFileLine(const SectionChunk *c,
                                                  uint32_t addr);
+
+// Parses the line tables of the given files in parallel ahead of many
+// getFileLine queries.
+void buildLineTableIndexes(llvm::ArrayRef<ObjFile *> files);
 }
 }
 
@@ -14,6 +14,7 @@
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Object/WindowsMachineFlag.h"
@@ -328,6 +329,14 @@ void SymbolTable::reportRemainingUndefines() {
     }
   }
 
+  // Reporting looks up the source location of every reference, so parse the
+  // line tables of all referencing files up front.
+  std::vector<ObjFile *> files;
+  for (const UndefinedDiag &undefDiag : undefDiags)
+    for (const UndefinedDiag::File &ref : undefDiag.files)
+      files.push_back(ref.oFile);
+  buildLineTableIndexes(files);
+
   for (const UndefinedDiag& undefDiag : undefDiags)
     reportUndefinedSymbol(undefDiag);
 }
@@ -340,6 +349,8 @@ std::pair<Symbol *, bool> SymbolTable::insert(StringRef name) {
     sym->isUsedInRegularObj = false;
     sym->pendingArchiveLoad = false;
     inserted = true;
+    if (mangleIndexBuilt)
+      addToMangleIndex(name, sym);
   }
   return {sym, inserted};
 }
@@ -536,19 +547,78 @@ Symbol *SymbolTable::findUnderscore(StringRef name) {
   return find(name);
 }
 
-// Return all symbols that start with Prefix, possibly ignoring the first
-// character of Prefix or the first character symbol.
-std::vector<Symbol *> SymbolTable::getSymsWithPrefix(StringRef prefix) {
-  std::vector<Symbol *> syms;
-  for (auto pair : symMap) {
-    StringRef name = pair.first.val();
-    if (name.startswith(prefix) || name.startswith(prefix.drop_front()) ||
-        name.drop_front().startswith(prefix) ||
-        name.drop_front().startswith(prefix.drop_front())) {
-      syms.push_back(pair.second);
+namespace {
+enum MangleKind { CXX, Stdcall, Fastcall, Vectorcall };
+} // namespace
+
+// Calls fn(kind, unmangled) for each unmangled name that findMangle() should
+// resolve to a symbol with the given mangled name.
+template <typename Fn> static void forEachUnmangledName(StringRef name, Fn fn) {
+  // C++ non-member functions: "?" + unmangled + "@@Y".
+  if (name.startswith("?"))
+    for (size_t p = name.find("@@Y", 1); p != StringRef::npos;
+         p = name.find("@@Y", p + 1))
+      fn(CXX, name.substr(1, p - 1));
+
+  if (config->machine != I386)
+    return;
+
+  // stdcall functions: unmangled + "@", where unmangled starts with "_".
+  if (name.startswith("_"))
+    for (size_t p = name.find('@'); p != StringRef::npos;
+         p = name.find('@', p + 1))
+      fn(Stdcall, name.substr(0, p));
+
+  // fastcall functions: "@" + unmangled without "_" + "@".
+  if (name.startswith("@"))
+    for (size_t p = name.find('@', 1); p != StringRef::npos;
+         p = name.find('@', p + 1))
+      fn(Fastcall, name.substr(1, p - 1));
+
+  // vectorcall functions: unmangled without "_" + "@@".
+  for (size_t p = name.find("@@"); p != StringRef::npos;
+       p = name.find("@@", p + 1))
+    fn(Vectorcall, name.substr(0, p));
+}
+
+void SymbolTable::addToMangleIndex(StringRef name, Symbol *sym) {
+  forEachUnmangledName(name, [&](MangleKind kind, StringRef unmangled) {
+    mangleIndex[kind].insert({CachedHashStringRef(unmangled), sym});
+  });
+}
+
+void SymbolTable::buildMangleIndex() {
+  struct Entry {
+    MangleKind kind;
+    CachedHashStringRef unmangled;
+    Symbol *sym;
+  };
+
+  std::vector<std::pair<StringRef, Symbol *>> syms;
+  syms.reserve(symMap.size());
+  for (auto &pair : symMap)
+    syms.emplace_back(pair.first.val(), pair.second);
+
+  // Decompose and hash the names in parallel, and then insert them in symbol
+  // table order, so that the first matching symbol in the table wins as it
+  // did when findMangle() scanned the whole table.
+  const size_t numShards = 256;
+  std::vector<std::vector<Entry>> shards(numShards);
+  parallelForEachN(0, numShards, [&](size_t shardIdx) {
+    size_t begin = syms.size() * shardIdx / numShards;
+    size_t end = syms.size() * (shardIdx + 1) / numShards;
+    for (size_t i = begin; i < end; ++i) {
+      Symbol *sym = syms[i].second;
+      forEachUnmangledName(syms[i].first, [&](MangleKind kind, StringRef s) {
+        shards[shardIdx].push_back({kind, CachedHashStringRef(s), sym});
+      });
     }
-  }
-  return syms;
+  });
+
+  for (std::vector<Entry> &shard : shards)
+    for (Entry &e : shard)
+      mangleIndex[e.kind].insert({e.unmangled, e.sym});
+  mangleIndexBuilt = true;
 }
 
 Symbol *SymbolTable::findMangle(StringRef name) {
@@ -556,36 +626,29 @@ Symbol *SymbolTable::findMangle(StringRef name) {
     if (!isa<Undefined>(sym))
       return sym;
 
-  // Efficient fuzzy string lookup is impossible with a hash table, so iterate
-  // the symbol table once and collect all possibly matching symbols into this
-  // vector. Then compare each possibly matching symbol with each possible
-  // mangling.
-  std::vector<Symbol *> syms = getSymsWithPrefix(name);
-  auto findByPrefix = [&syms](const Twine &t) -> Symbol * {
-    std::string prefix = t.str();
-    for (auto *s : syms)
-      if (s->getName().startswith(prefix))
-        return s;
-    return nullptr;
+  if (!mangleIndexBuilt)
+    buildMangleIndex();
+  auto lookup = [&](MangleKind kind, StringRef unmangled) -> Symbol * {
+    return mangleIndex[kind].lookup(CachedHashStringRef(unmangled));
   };
 
   // For non-x86, just look for C++ functions.
   if (config->machine != I386)
-    return findByPrefix("?" + name + "@@Y");
+    return lookup(CXX, name);
 
   if (!name.startswith("_"))
     return nullptr;
   // Search for x86 stdcall function.
-  if (Symbol *s = findByPrefix(name + "@"))
+  if (Symbol *s = lookup(Stdcall, name))
     return s;
   // Search for x86 fastcall function.
-  if (Symbol *s = findByPrefix("@" + name.substr(1) + "@"))
+  if (Symbol *s = lookup(Fastcall, name.substr(1)))
     return s;
   // Search for x86 vectorcall function.
-  if (Symbol *s = findByPrefix(name.substr(1) + "@@"))
+  if (Symbol *s = lookup(Vectorcall, name.substr(1)))
     return s;
   // Search for x86 C++ non-member function.
-  return findByPrefix("?" + name.substr(1) + "@@Y");
+  return lookup(CXX, name.substr(1));
 }
 
 Symbol *SymbolTable::addUndefined(StringRef name) {
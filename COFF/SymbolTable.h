@@ -116,9 +116,16 @@ private:
   /// Same as insert(Name), but also sets isUsedInRegularObj.
   std::pair<Symbol *, bool> insert(StringRef name, InputFile *f);
 
-  std::vector<Symbol *> getSymsWithPrefix(StringRef prefix);
+  void buildMangleIndex();
+  void addToMangleIndex(StringRef name, Symbol *sym);
 
   llvm::DenseMap<llvm::CachedHashStringRef, Symbol *> symMap;
+
+  // findMangle() looks up unmangled names in one index per kind of mangling.
+  // The indices are built on the first call and kept up to date by insert()
+  // afterwards.
+  llvm::DenseMap<llvm::CachedHashStringRef, Symbol *> mangleIndex[4];
+  bool mangleIndexBuilt = false;
   std::unique_ptr<BitcodeCompiler> lto;
 };
 
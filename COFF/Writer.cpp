@@ -19,17 +19,21 @@
 #include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/BinaryStreamReader.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/RandomNumberGenerator.h"
 #include "llvm/Support/xxhash.h"
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <map>
 #include <memory>
@@ -210,7 +214,8 @@ private:
   void createGuardCFTables();
   void markSymbolsForRVATable(ObjFile *file,
                               ArrayRef<SectionChunk *> symIdxChunks,
-                              SymbolRVASet &tableSymbols);
+                              SymbolRVASet &tableSymbols,
+                              std::vector<std::string> &warnings);
   void maybeAddRVATable(SymbolRVASet tableSymbols, StringRef tableSym,
                         StringRef countSym);
   void setSectionPermissions();
@@ -229,7 +234,7 @@ private:
 
   OutputSection *findSection(StringRef name);
   void addBaserels();
-  void addBaserelBlocks(std::vector<Baserel> &v);
+  void writeBaserelStats();
 
   uint32_t getSizeOfInitializedData();
 
@@ -365,6 +370,31 @@ static bool isInRange(uint16_t relType, uint64_t s, uint64_t p, int margin) {
   }
 }
 
+// Returns true if relocations of type relType may be out of range and need
+// a thunk. This matches the relocation types isInRange() checks.
+static bool hasLimitedRange(uint16_t relType) {
+  if (config->machine == ARMNT)
+    return relType == IMAGE_REL_ARM_BRANCH20T ||
+           relType == IMAGE_REL_ARM_BRANCH24T ||
+           relType == IMAGE_REL_ARM_BLX23T;
+  if (config->machine == ARM64)
+    return relType == IMAGE_REL_ARM64_BRANCH26 ||
+           relType == IMAGE_REL_ARM64_BRANCH19 ||
+           relType == IMAGE_REL_ARM64_BRANCH14;
+  return false;
+}
+
+namespace {
+// A relocation whose type has a limited range. inRangeAtOrigin is set once
+// the relocation has been found in range while neither its source nor its
+// target had been moved by thunks.
+struct RangeLimitedReloc {
+  SectionChunk *sc;
+  uint32_t relIdx;
+  bool inRangeAtOrigin = false;
+};
+} // namespace
+
 // Return the last thunk for the given target if it is in range,
 // or create a new one.
 static std::pair<Defined *, bool>
@@ -400,7 +430,9 @@ getThunk(DenseMap<uint64_t, Defined *> &lastThunks, Defined *target, uint64_t p,
 // After adding thunks, we verify that all relocations are in range (with
 // no extra margin requirements). If this failed, we restart (throwing away
 // the previously created thunks) and retry with a wider margin.
-static bool createThunks(OutputSection *os, int margin) {
+static bool createThunks(OutputSection *os,
+                         const DenseSet<SectionChunk *> &branchChunks,
+                         int margin, std::vector<Chunk *> &newThunks) {
   bool addressesChanged = false;
   DenseMap<uint64_t, Defined *> lastThunks;
   DenseMap<std::pair<ObjFile *, Defined *>, uint32_t> thunkSymtabIndices;
@@ -409,7 +441,7 @@ static bool createThunks(OutputSection *os, int margin) {
   // elements into it.
   for (size_t i = 0; i != os->chunks.size(); ++i) {
     SectionChunk *sc = dyn_cast_or_null<SectionChunk>(os->chunks[i]);
-    if (!sc)
+    if (!sc || !branchChunks.count(sc))
       continue;
     size_t thunkInsertionSpot = i + 1;
 
@@ -450,6 +482,7 @@ static bool createThunks(OutputSection *os, int margin) {
         thunkChunk->setRVA(
             thunkInsertionRVA); // Estimate of where it will be located.
         os->chunks.insert(os->chunks.begin() + thunkInsertionSpot, thunkChunk);
+        newThunks.push_back(thunkChunk);
         thunkInsertionSpot++;
         thunksSize += thunkChunk->getSize();
         thunkInsertionRVA += thunkChunk->getSize();
@@ -499,29 +532,37 @@ static bool createThunks(OutputSection *os, int margin) {
 }
 
 // Verify that all relocations are in range, with no extra margin requirements.
-static bool verifyRanges(const std::vector<Chunk *> chunks) {
-  for (Chunk *c : chunks) {
-    SectionChunk *sc = dyn_cast_or_null<SectionChunk>(c);
-    if (!sc)
-      continue;
-
-    ArrayRef<coff_relocation> relocs = sc->getRelocs();
-    for (size_t j = 0, e = relocs.size(); j < e; ++j) {
-      const coff_relocation &rel = relocs[j];
-      Symbol *relocTarget = sc->file->getSymbol(rel.SymbolTableIndex);
-
-      Defined *sym = dyn_cast_or_null<Defined>(relocTarget);
-      if (!sym)
-        continue;
+//
+// Nothing below firstThunkRVA has moved since the original layout, so a
+// relocation whose source and target both lie there and that was already
+// found in range at those addresses doesn't need to be checked again.
+static bool verifyRanges(MutableArrayRef<RangeLimitedReloc> relocs,
+                         uint64_t firstThunkRVA,
+                         std::atomic<size_t> &numChecked) {
+  std::atomic<bool> ok{true};
+  parallelForEach(relocs, [&](RangeLimitedReloc &r) {
+    const coff_relocation &rel = r.sc->getRelocs()[r.relIdx];
+    Symbol *relocTarget = r.sc->file->getSymbol(rel.SymbolTableIndex);
+
+    Defined *sym = dyn_cast_or_null<Defined>(relocTarget);
+    if (!sym)
+      return;
 
-      uint64_t p = sc->getRVA() + rel.VirtualAddress;
-      uint64_t s = sym->getRVA();
+    uint64_t s = sym->getRVA();
+    bool unmoved = r.sc->getRVA() < firstThunkRVA && s < firstThunkRVA;
+    if (unmoved && r.inRangeAtOrigin)
+      return;
 
-      if (!isInRange(rel.Type, s, p, 0))
-        return false;
+    ++numChecked;
+    uint64_t p = r.sc->getRVA() + rel.VirtualAddress;
+    if (!isInRange(rel.Type, s, p, 0)) {
+      ok = false;
+      return;
     }
-  }
-  return true;
+    if (unmoved)
+      r.inRangeAtOrigin = true;
+  });
+  return ok;
 }
 
 // Assign addresses and add thunks if necessary.
@@ -530,21 +571,44 @@ void Writer::finalizeAddresses() {
   if (config->machine != ARMNT && config->machine != ARM64)
     return;
 
+  // Only relocations with a limited range can need thunks, so collect them
+  // once instead of scanning every relocation in every pass.
   size_t origNumChunks = 0;
+  DenseMap<OutputSection *, std::vector<RangeLimitedReloc>> rangeLimitedRelocs;
+  DenseSet<SectionChunk *> branchChunks;
   for (OutputSection *sec : outputSections) {
     sec->origChunks = sec->chunks;
     origNumChunks += sec->chunks.size();
+
+    std::vector<RangeLimitedReloc> &v = rangeLimitedRelocs[sec];
+    for (Chunk *c : sec->chunks) {
+      SectionChunk *sc = dyn_cast<SectionChunk>(c);
+      if (!sc)
+        continue;
+      ArrayRef<coff_relocation> relocs = sc->getRelocs();
+      for (size_t j = 0, e = relocs.size(); j < e; ++j) {
+        if (!hasLimitedRange(relocs[j].Type))
+          continue;
+        v.push_back({sc, (uint32_t)j});
+        branchChunks.insert(sc);
+      }
+    }
   }
 
   int pass = 0;
   int margin = 1024 * 100;
+  uint64_t firstThunkRVA = UINT64_MAX;
+  size_t numRelocs = 0;
+  std::atomic<size_t> numChecked{0};
+  for (auto &kv : rangeLimitedRelocs)
+    numRelocs += kv.second.size();
   while (true) {
     // First check whether we need thunks at all, or if the previous pass of
     // adding them turned out ok.
     bool rangesOk = true;
     size_t numChunks = 0;
     for (OutputSection *sec : outputSections) {
-      if (!verifyRanges(sec->chunks)) {
+      if (!verifyRanges(rangeLimitedRelocs[sec], firstThunkRVA, numChecked)) {
         rangesOk = false;
         break;
       }
@@ -553,7 +617,9 @@ void Writer::finalizeAddresses() {
     if (rangesOk) {
       if (pass > 0)
         log("Added " + Twine(numChunks - origNumChunks) + " thunks with " +
-            "margin " + Twine(margin) + " in " + Twine(pass) + " passes");
+            "margin " + Twine(margin) + " in " + Twine(pass) + " passes, " +
+            "checking " + Twine(numChecked) + " ranges for " +
+            Twine(numRelocs) + " relocations");
       return;
     }
 
@@ -572,8 +638,9 @@ void Writer::finalizeAddresses() {
     // Try adding thunks everywhere where it is needed, with a margin
     // to avoid things going out of range due to the added thunks.
     bool addressesChanged = false;
+    std::vector<Chunk *> newThunks;
     for (OutputSection *sec : outputSections)
-      addressesChanged |= createThunks(sec, margin);
+      addressesChanged |= createThunks(sec, branchChunks, margin, newThunks);
     // If the verification above thought we needed thunks, we should have
     // added some.
     assert(addressesChanged);
@@ -582,6 +649,11 @@ void Writer::finalizeAddresses() {
     // the start of the next round).
     assignAddresses();
 
+    // Everything before the first thunk is still at its original address.
+    firstThunkRVA = UINT64_MAX;
+    for (Chunk *c : newThunks)
+      firstThunkRVA = std::min<uint64_t>(firstThunkRVA, c->getRVA());
+
     pass++;
   }
 }
@@ -625,6 +697,7 @@ void Writer::run() {
   writeBuildId();
 
   writeMapFile(outputSections);
+  writeBaserelStats();
 
   if (errorCount())
     return;
@@ -1458,13 +1531,43 @@ void Writer::openFile(StringRef path) {
       "failed to open " + path);
 }
 
+// Concatenates RVA sets collected for each object file and uniques them.
+static SymbolRVASet mergeRVASets(std::vector<SymbolRVASet> &sets) {
+  size_t size = 0;
+  for (SymbolRVASet &set : sets)
+    size += set.size();
+
+  SymbolRVASet ret;
+  ret.reserve(size);
+  for (SymbolRVASet &set : sets)
+    ret.insert(ret.end(), set.begin(), set.end());
+  uniqueRVASet(ret);
+  return ret;
+}
+
+// Reports warnings collected for each object file in parallel, in the order
+// of the files, so that the output doesn't depend on thread scheduling.
+static void reportWarnings(ArrayRef<std::vector<std::string>> warnings) {
+  for (const std::vector<std::string> &v : warnings)
+    for (const std::string &msg : v)
+      warn(msg);
+}
+
 void Writer::createSEHTable() {
-  SymbolRVASet handlers;
-  for (ObjFile *file : ObjFile::instances) {
+  for (ObjFile *file : ObjFile::instances)
     if (!file->hasSafeSEH())
       error("/safeseh: " + file->getName() + " is not compatible with SEH");
-    markSymbolsForRVATable(file, file->getSXDataChunks(), handlers);
-  }
+
+  size_t numFiles = ObjFile::instances.size();
+  std::vector<SymbolRVASet> perFile(numFiles);
+  std::vector<std::vector<std::string>> warnings(numFiles);
+  parallelForEachN(0, numFiles, [&](size_t i) {
+    ObjFile *file = ObjFile::instances[i];
+    markSymbolsForRVATable(file, file->getSXDataChunks(), perFile[i],
+                           warnings[i]);
+  });
+  reportWarnings(warnings);
+  SymbolRVASet handlers = mergeRVASets(perFile);
 
   // Set the "no SEH" characteristic if there really were no handlers, or if
   // there is no load config object to point to the table of handlers.
@@ -1483,7 +1586,7 @@ static void addSymbolToRVASet(SymbolRVASet &rvaSet, Defined *s) {
   if (auto *sc = dyn_cast<SectionChunk>(c))
     c = sc->repl; // Look through ICF replacement.
   uint32_t off = s->getRVA() - (c ? c->getRVA() : 0);
-  rvaSet.insert({c, off});
+  rvaSet.push_back({c, off});
 }
 
 // Given a symbol, add it to the GFIDs table if it is a live, defined, function
@@ -1560,29 +1663,41 @@ static void markSymbolsWithRelocations(ObjFile *file,
 // address-taken functions. It is sorted and uniqued, just like the safe SEH
 // table.
 void Writer::createGuardCFTables() {
-  SymbolRVASet addressTakenSyms;
-  SymbolRVASet longJmpTargets;
-  for (ObjFile *file : ObjFile::instances) {
+  // The address-taken symbols and longjmp targets are collected for each
+  // object file in parallel. The last element of addressTaken is for the
+  // symbols added by the linker.
+  size_t numFiles = ObjFile::instances.size();
+  std::vector<SymbolRVASet> addressTaken(numFiles + 1);
+  std::vector<SymbolRVASet> longJmp(numFiles);
+  std::vector<std::vector<std::string>> warnings(numFiles);
+  parallelForEachN(0, numFiles, [&](size_t i) {
+    ObjFile *file = ObjFile::instances[i];
     // If the object was compiled with /guard:cf, the address taken symbols
     // are in .gfids$y sections, and the longjmp targets are in .gljmp$y
     // sections. If the object was not compiled with /guard:cf, we assume there
     // were no setjmp targets, and that all code symbols with relocations are
     // possibly address-taken.
     if (file->hasGuardCF()) {
-      markSymbolsForRVATable(file, file->getGuardFidChunks(), addressTakenSyms);
-      markSymbolsForRVATable(file, file->getGuardLJmpChunks(), longJmpTargets);
+      markSymbolsForRVATable(file, file->getGuardFidChunks(), addressTaken[i],
+                             warnings[i]);
+      markSymbolsForRVATable(file, file->getGuardLJmpChunks(), longJmp[i],
+                             warnings[i]);
     } else {
-      markSymbolsWithRelocations(file, addressTakenSyms);
+      markSymbolsWithRelocations(file, addressTaken[i]);
     }
-  }
+  });
+  reportWarnings(warnings);
 
   // Mark the image entry as address-taken.
   if (config->entry)
-    maybeAddAddressTakenFunction(addressTakenSyms, config->entry);
+    maybeAddAddressTakenFunction(addressTaken[numFiles], config->entry);
 
   // Mark exported symbols in executable sections as address-taken.
   for (Export &e : config->exports)
-    maybeAddAddressTakenFunction(addressTakenSyms, e.sym);
+    maybeAddAddressTakenFunction(addressTaken[numFiles], e.sym);
+
+  SymbolRVASet addressTakenSyms = mergeRVASets(addressTaken);
+  SymbolRVASet longJmpTargets = mergeRVASets(longJmp);
 
   // Ensure sections referenced in the gfid table are 16-byte aligned.
   for (const ChunkAndOffset &c : addressTakenSyms)
@@ -1610,9 +1725,12 @@ void Writer::createGuardCFTables() {
 // Take a list of input sections containing symbol table indices and add those
 // symbols to an RVA table. The challenge is that symbol RVAs are not known and
 // depend on the table size, so we can't directly build a set of integers.
+// This runs in parallel for different files, so warnings are appended to
+// warnings and reported by the caller.
 void Writer::markSymbolsForRVATable(ObjFile *file,
                                     ArrayRef<SectionChunk *> symIdxChunks,
-                                    SymbolRVASet &tableSymbols) {
+                                    SymbolRVASet &tableSymbols,
+                                    std::vector<std::string> &warnings) {
   for (SectionChunk *c : symIdxChunks) {
     // Skip sections discarded by linker GC. This comes up when a .gfids section
     // is associated with something like a vtable and the vtable is discarded.
@@ -1624,8 +1742,9 @@ void Writer::markSymbolsForRVATable(ObjFile *file,
     // Validate that the contents look like symbol table indices.
     ArrayRef<uint8_t> data = c->getContents();
     if (data.size() % 4 != 0) {
-      warn("ignoring " + c->getSectionName() +
-           " symbol table index section in object " + toString(file));
+      warnings.push_back("ignoring " + c->getSectionName().str() +
+                         " symbol table index section in object " +
+                         toString(file));
       continue;
     }
 
@@ -1636,8 +1755,9 @@ void Writer::markSymbolsForRVATable(ObjFile *file,
     ArrayRef<Symbol *> objSymbols = file->getSymbols();
     for (uint32_t symIndex : symIndices) {
       if (symIndex >= objSymbols.size()) {
-        warn("ignoring invalid symbol table index in section " +
-             c->getSectionName() + " in object " + toString(file));
+        warnings.push_back("ignoring invalid symbol table index in section " +
+                           c->getSectionName().str() + " in object " +
+                           toString(file));
         continue;
       }
       if (Symbol *s = objSymbols[symIndex]) {
@@ -1747,6 +1867,24 @@ void Writer::writeSections() {
   }
 }
 
+// Computes a hash of data by hashing 1 MiB chunks in parallel and then
+// hashing the concatenation of the chunk hashes.
+static void
+computeHash(MutableArrayRef<uint8_t> hashBuf, ArrayRef<uint8_t> data,
+            function_ref<void(uint8_t *dest, ArrayRef<uint8_t> arr)> hashFn) {
+  const size_t chunkSize = 1024 * 1024;
+  size_t numChunks = std::max<size_t>(1, divideCeil(data.size(), chunkSize));
+  std::vector<uint8_t> hashes(numChunks * hashBuf.size());
+
+  parallelForEachN(0, numChunks, [&](size_t i) {
+    ArrayRef<uint8_t> chunk =
+        data.slice(std::min(i * chunkSize, data.size())).take_front(chunkSize);
+    hashFn(hashes.data() + i * hashBuf.size(), chunk);
+  });
+
+  hashFn(hashBuf.data(), hashes);
+}
+
 void Writer::writeBuildId() {
   // There are two important parts to the build ID.
   // 1) If building with debug info, the COFF debug directory contains a
@@ -1768,24 +1906,36 @@ void Writer::writeBuildId() {
       buffer->getBufferSize());
 
   uint32_t timestamp = config->timestamp;
-  uint64_t hash = 0;
+  uint8_t hash[16] = {};
   bool generateSyntheticBuildId =
       config->mingw && config->debug && config->pdbPath.empty();
 
-  if (config->repro || generateSyntheticBuildId)
-    hash = xxHash64(outputFileData);
+  if (config->repro || generateSyntheticBuildId) {
+    if (config->buildIdHash128)
+      computeHash(hash, arrayRefFromStringRef(outputFileData),
+                  [](uint8_t *dest, ArrayRef<uint8_t> arr) {
+                    memcpy(dest, MD5::hash(arr).data(), 16);
+                  });
+    else
+      computeHash(makeMutableArrayRef(hash, 8),
+                  arrayRefFromStringRef(outputFileData),
+                  [](uint8_t *dest, ArrayRef<uint8_t> arr) {
+                    write64le(dest, xxHash64(arr));
+                  });
+  }
 
   if (config->repro)
-    timestamp = static_cast<uint32_t>(hash);
+    timestamp = read32le(hash);
 
   if (generateSyntheticBuildId) {
     // For MinGW builds without a PDB file, we still generate a build id
     // to allow associating a crash dump to the executable.
     buildId->buildId->PDB70.CVSignature = OMF::Signature::PDB70;
     buildId->buildId->PDB70.Age = 1;
-    memcpy(buildId->buildId->PDB70.Signature, &hash, 8);
+    memcpy(buildId->buildId->PDB70.Signature, hash, 16);
     // xxhash only gives us 8 bytes, so put some fixed data in the other half.
-    memcpy(&buildId->buildId->PDB70.Signature[8], "LLD PDB.", 8);
+    if (!config->buildIdHash128)
+      memcpy(&buildId->buildId->PDB70.Signature[8], "LLD PDB.", 8);
   }
 
   if (debugDirectory)
@@ -1883,36 +2033,76 @@ void Writer::addBaserels() {
   if (!config->relocatable)
     return;
   relocSec->chunks.clear();
-  std::vector<Baserel> v;
   for (OutputSection *sec : outputSections) {
     if (sec->header.Characteristics & IMAGE_SCN_MEM_DISCARDABLE)
       continue;
-    // Collect all locations for base relocations.
-    for (Chunk *c : sec->chunks)
-      c->getBaserels(&v);
+    // Collect all locations for base relocations. Chunks are in address
+    // order, so concatenating the results of each chunk gives the same order
+    // as a serial walk.
+    std::vector<std::vector<Baserel>> perChunk(sec->chunks.size());
+    parallelForEachN(0, sec->chunks.size(), [&](size_t i) {
+      sec->chunks[i]->getBaserels(&perChunk[i]);
+    });
+
+    size_t numRelocs = 0;
+    for (std::vector<Baserel> &v : perChunk)
+      numRelocs += v.size();
+    if (numRelocs == 0)
+      continue;
+
+    std::vector<Baserel> v;
+    v.reserve(numRelocs);
+    for (std::vector<Baserel> &c : perChunk)
+      v.insert(v.end(), c.begin(), c.end());
+
     // Add the addresses to .reloc section.
-    if (!v.empty())
-      addBaserelBlocks(v);
-    v.clear();
+    relocSec->addChunk(make<BaserelChunk>(sec->name, std::move(v)));
   }
 }
 
-// Add addresses to .reloc section. Note that addresses are grouped by page.
-void Writer::addBaserelBlocks(std::vector<Baserel> &v) {
-  const uint32_t mask = ~uint32_t(pageSize - 1);
-  uint32_t page = v[0].rva & mask;
-  size_t i = 0, j = 1;
-  for (size_t e = v.size(); j < e; ++j) {
-    uint32_t p = v[j].rva & mask;
-    if (p == page)
-      continue;
-    relocSec->addChunk(make<BaserelChunk>(page, &v[i], &v[0] + j));
-    i = j;
-    page = p;
-  }
-  if (i == j)
+// Write the number of base relocations in each page, densest first. The
+// loader touches every page with base relocations when an image is rebased,
+// so this shows which code or data to move closer together.
+void Writer::writeBaserelStats() {
+  if (config->baserelStatsFile.empty())
+    return;
+
+  std::error_code ec;
+  raw_fd_ostream os(config->baserelStatsFile, ec, sys::fs::F_Text);
+  if (ec) {
+    error("cannot open " + config->baserelStatsFile + ": " + ec.message());
     return;
-  relocSec->addChunk(make<BaserelChunk>(page, &v[i], &v[0] + j));
+  }
+
+  struct PageStats {
+    uint32_t page;
+    uint32_t count;
+    StringRef secName;
+  };
+  std::vector<PageStats> pages;
+  DenseMap<uint32_t, size_t> pageIndex;
+  size_t numRelocs = 0;
+  for (Chunk *c : relocSec->chunks) {
+    auto *bc = static_cast<BaserelChunk *>(c);
+    numRelocs += bc->relocs.size();
+    for (const BaserelChunk::Block &b : bc->blocks) {
+      // Relocations that are out of order can give a page several blocks.
+      auto p = pageIndex.insert({b.page, pages.size()});
+      if (p.second)
+        pages.push_back({b.page, 0, bc->secName});
+      pages[p.first->second].count += b.end - b.begin;
+    }
+  }
+  std::stable_sort(pages.begin(), pages.end(),
+                   [](const PageStats &a, const PageStats &b) {
+                     return a.count > b.count;
+                   });
+
+  os << "Base relocations: " << numRelocs << " in " << pages.size()
+     << " pages\n";
+  os << "    Page  Count  Section\n";
+  for (const PageStats &p : pages)
+    os << format("%08x %6u  ", p.page, p.count) << p.secName << "\n";
 }
 
 PartialSection *Writer::createPartialSection(StringRef name,
@@ -7,6 +7,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Memory.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+#if defined(LLVM_ON_UNIX)
+#include <sys/resource.h>
+#endif
 
 using namespace llvm;
 using namespace lld;
@@ -20,3 +28,49 @@ void lld::freeArena() {
     alloc->reset();
   bAlloc.Reset();
 }
+
+uint64_t lld::getPeakRSS() {
+#if defined(LLVM_ON_UNIX)
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0)
+    return 0;
+#if defined(__APPLE__)
+  return ru.ru_maxrss;
+#else
+  return (uint64_t)ru.ru_maxrss * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+void lld::printArenaUsage(raw_ostream &os) {
+  std::vector<SpecificAllocBase *> v;
+  for (SpecificAllocBase *alloc : SpecificAllocBase::instances)
+    if (alloc->numObjects)
+      v.push_back(alloc);
+
+  auto getBytes = [](const SpecificAllocBase *alloc) {
+    return alloc->numObjects * alloc->getObjectSize();
+  };
+  std::stable_sort(v.begin(), v.end(),
+                   [&](SpecificAllocBase *a, SpecificAllocBase *b) {
+                     return getBytes(a) > getBytes(b);
+                   });
+
+  uint64_t total = 0;
+  for (SpecificAllocBase *alloc : v) {
+    os << format("%12zu x %4zu bytes = %12zu bytes  ", alloc->numObjects,
+                 alloc->getObjectSize(), getBytes(alloc))
+       << alloc->getTypeName() << "\n";
+    total += getBytes(alloc);
+  }
+  os << format("%-33s%12llu bytes\n", "Typed arenas total:",
+               (unsigned long long)total);
+  os << format("%-33s%12llu bytes\n", "Bump allocator:",
+               (unsigned long long)bAlloc.getBytesAllocated());
+
+  if (uint64_t rss = getPeakRSS())
+    os << format("%-33s%12llu bytes\n", "Peak RSS:",
+                  (unsigned long long)rss);
+}
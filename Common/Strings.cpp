@@ -60,6 +60,7 @@ StringMatcher::StringMatcher(ArrayRef<StringRef> pat) {
       error(toString(pat.takeError()));
     else
       patterns.push_back(*pat);
+    strings.push_back(s);
   }
 }
 
@@ -7,5 +7,138 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Threads.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Threading.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace llvm;
+using namespace lld;
 
 bool lld::threadsEnabled = true;
+unsigned lld::threadCount = 0;
+
+unsigned lld::getThreadLimit() {
+  for (Timer *t = Timer::current(); t; t = t->getParent())
+    if (t->threadLimit)
+      return t->threadLimit;
+  if (threadCount)
+    return threadCount;
+  return std::max(1u, llvm::hardware_concurrency());
+}
+
+void lld::setThreadAffinity(StringRef cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  SmallVector<StringRef, 4> ranges;
+  cpus.split(ranges, ',', -1, false);
+  for (StringRef range : ranges) {
+    StringRef first, last;
+    std::tie(first, last) = range.split('-');
+    if (last.empty())
+      last = first;
+
+    unsigned lo, hi;
+    if (first.getAsInteger(10, lo) || last.getAsInteger(10, hi) || lo > hi ||
+        hi >= CPU_SETSIZE) {
+      error("--thread-affinity: invalid CPU range: " + range);
+      return;
+    }
+    for (unsigned i = lo; i <= hi; ++i)
+      CPU_SET(i, &set);
+  }
+
+  if (CPU_COUNT(&set) == 0) {
+    error("--thread-affinity: no CPU specified");
+    return;
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    error("--thread-affinity: cannot set CPU affinity: " +
+          std::error_code(errno, std::generic_category()).message());
+    return;
+  }
+
+  // Do not start more threads than there are CPUs to run them unless the
+  // user explicitly asked for that.
+  if (threadCount == 0)
+    threadCount = CPU_COUNT(&set);
+#else
+  warn("--thread-affinity is not supported on this host; ignored");
+#endif
+}
+
+void lld::setPhaseThreads(StringRef spec) {
+  StringRef phase, count;
+  std::tie(phase, count) = spec.rsplit(':');
+
+  unsigned n;
+  if (phase.empty() || count.getAsInteger(10, n) || n == 0) {
+    error("--phase-threads: expected <phase>:<N> with N > 0, but got " + spec);
+    return;
+  }
+
+  std::vector<Timer *> timers = Timer::find(phase);
+  if (timers.empty()) {
+    error("--phase-threads: unknown phase: " + phase);
+    return;
+  }
+  for (Timer *t : timers)
+    t->threadLimit = n;
+}
+
+void lld::parallelForEachN(size_t begin, size_t end,
+                           function_ref<void(size_t)> fn) {
+  if (begin >= end)
+    return;
+
+  Timer *timer = Timer::current();
+  if (!timer)
+    timer = &Timer::root();
+
+  unsigned numThreads = threadsEnabled ? getThreadLimit() : 1;
+  numThreads = std::min<size_t>(numThreads, end - begin);
+
+  // Threads take small chunks of the range from a shared counter, so a
+  // thread that finishes early picks up the remaining work instead of
+  // waiting for a thread that got expensive items.
+  size_t grainSize = std::max<size_t>(1, (end - begin) / (numThreads * 32));
+  std::atomic<size_t> next(begin);
+
+  auto worker = [&] {
+    Timer::Clock::time_point start = Timer::Clock::now();
+    for (;;) {
+      size_t i = next.fetch_add(grainSize);
+      if (i >= end)
+        break;
+      for (size_t e = std::min(i + grainSize, end); i < e; ++i)
+        fn(i);
+    }
+    timer->addParallelWork(start, Timer::Clock::now());
+  };
+
+  Timer::Clock::time_point start = Timer::Clock::now();
+#if LLVM_ENABLE_THREADS
+  if (numThreads > 1) {
+    parallel::detail::TaskGroup tg;
+    for (unsigned i = 1; i < numThreads; ++i)
+      tg.spawn(worker);
+    worker();
+    tg.sync();
+  } else {
+    worker();
+  }
+#else
+  worker();
+#endif
+  timer->addParallelLoop(Timer::Clock::now() - start);
+}
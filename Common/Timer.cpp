@@ -8,34 +8,86 @@
 
 #include "lld/Common/Timer.h"
 #include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include <algorithm>
+#include <mutex>
 
 using namespace lld;
 using namespace llvm;
 
-ScopedTimer::ScopedTimer(Timer &t) : t(&t) { t.start(); }
+bool lld::timeTraceEnabled = false;
+
+static Timer *currentTimer = nullptr;
+
+ScopedTimer::ScopedTimer(Timer &t) : t(&t), prev(currentTimer) {
+  currentTimer = &t;
+  t.start();
+}
 
 void ScopedTimer::stop() {
   if (!t)
     return;
   t->stop();
+  currentTimer = prev;
   t = nullptr;
 }
 
 ScopedTimer::~ScopedTimer() { stop(); }
 
+static std::vector<Timer *> &getAllTimers() {
+  static std::vector<Timer *> timers;
+  return timers;
+}
+
 Timer::Timer(llvm::StringRef name) : name(name), parent(nullptr) {}
 Timer::Timer(llvm::StringRef name, Timer &parent)
-    : name(name), parent(&parent) {}
+    : name(name), parent(&parent) {
+  getAllTimers().push_back(this);
+}
+
+namespace {
+struct TraceEvent {
+  const Timer *timer;
+  Timer::Clock::time_point begin;
+  Timer::Clock::time_point end;
+};
+
+// Spans recorded by one thread. Each thread appends only to its own
+// buffer, so recording does not need a lock; the lock only protects the
+// list of buffers.
+struct ThreadTrace {
+  unsigned tid;
+  std::vector<TraceEvent> events;
+};
+} // namespace
+
+static std::mutex traceMu;
+static std::vector<std::unique_ptr<ThreadTrace>> threadTraces;
+
+static ThreadTrace &getThreadTrace() {
+  static thread_local ThreadTrace *trace = nullptr;
+  if (!trace) {
+    std::lock_guard<std::mutex> lock(traceMu);
+    threadTraces.push_back(llvm::make_unique<ThreadTrace>());
+    trace = threadTraces.back().get();
+    trace->tid = threadTraces.size() - 1;
+  }
+  return *trace;
+}
 
 void Timer::start() {
   if (parent && total.count() == 0)
     parent->children.push_back(this);
-  startTime = std::chrono::high_resolution_clock::now();
+  startTime = Clock::now();
 }
 
 void Timer::stop() {
-  total += (std::chrono::high_resolution_clock::now() - startTime);
+  Clock::time_point now = Clock::now();
+  total += (now - startTime);
+  if (timeTraceEnabled)
+    getThreadTrace().events.push_back({this, startTime, now});
 }
 
 Timer &Timer::root() {
@@ -43,6 +95,38 @@ Timer &Timer::root() {
   return rootTimer;
 }
 
+Timer *Timer::current() { return currentTimer; }
+
+// Returns a timer name as it is spelled on the command line.
+static std::string getPhaseName(StringRef name) {
+  std::string s = name.lower();
+  std::replace(s.begin(), s.end(), ' ', '-');
+  return s;
+}
+
+std::vector<Timer *> Timer::find(StringRef phase) {
+  // Different drivers may have timers of the same name, e.g. "ICF".
+  std::string s = getPhaseName(phase);
+  std::vector<Timer *> ret;
+  for (Timer *t : getAllTimers())
+    if (getPhaseName(t->name) == s)
+      ret.push_back(t);
+  return ret;
+}
+
+void Timer::addParallelWork(Clock::time_point begin, Clock::time_point end) {
+  parallelBusy += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      end - begin)
+                      .count();
+  if (timeTraceEnabled)
+    getThreadTrace().events.push_back({this, begin, end});
+}
+
+void Timer::addParallelLoop(Clock::duration d) {
+  parallelWall +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
 void Timer::print() {
   double totalDuration = static_cast<double>(root().millis());
 
@@ -70,6 +154,11 @@ void Timer::print(int depth, double totalDuration, bool recurse) const {
   std::string s = std::string(depth * 2, ' ') + name + std::string(":");
   stream << format("%-30s%5d ms (%5.1f%%)", s.c_str(), (int)millis(), p);
 
+  // For phases with parallel loops, show how many threads were busy on
+  // average while the loops ran.
+  if (parallelWall > 0)
+    stream << format("  %5.1fx parallel", (double)parallelBusy / parallelWall);
+
   message(str);
 
   if (recurse) {
@@ -77,3 +166,49 @@ void Timer::print(int depth, double totalDuration, bool recurse) const {
       child->print(depth + 1, totalDuration);
   }
 }
+
+void lld::writeTimeTrace(raw_ostream &os) {
+  using namespace std::chrono;
+  Timer::Clock::time_point epoch = Timer::Clock::time_point::max();
+  for (std::unique_ptr<ThreadTrace> &trace : threadTraces) {
+    for (const TraceEvent &e : trace->events)
+      epoch = std::min(epoch, e.begin);
+  }
+
+  auto toMicros = [](Timer::Clock::duration d) {
+    return (int64_t)duration_cast<microseconds>(d).count();
+  };
+
+  // Buffers are numbered in the order threads first recorded a span, which
+  // depends on when time tracing was enabled. The thread writing the trace
+  // is the one that drove the timers, so show it first as thread 0.
+  unsigned self = getThreadTrace().tid;
+  auto getTid = [&](unsigned tid) {
+    return tid == self ? 0 : tid == 0 ? self : tid;
+  };
+
+  json::Array events;
+  for (std::unique_ptr<ThreadTrace> &trace : threadTraces) {
+    unsigned tid = getTid(trace->tid);
+    std::string name =
+        tid == 0 ? std::string("lld") : "lld worker " + std::to_string(tid);
+    events.push_back(json::Object{
+        {"ph", "M"},
+        {"name", "thread_name"},
+        {"pid", 1},
+        {"tid", tid},
+        {"args", json::Object{{"name", name}}},
+    });
+    for (const TraceEvent &e : trace->events)
+      events.push_back(json::Object{
+          {"ph", "X"},
+          {"name", e.timer->getName()},
+          {"pid", 1},
+          {"tid", tid},
+          {"ts", toMicros(e.begin - epoch)},
+          {"dur", toMicros(e.end - e.begin)},
+      });
+  }
+
+  os << json::Value(json::Object{{"traceEvents", std::move(events)}}) << "\n";
+}
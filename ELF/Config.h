@@ -98,6 +98,7 @@ struct Configuration {
   llvm::StringRef ltoSampleProfile;
   llvm::StringRef mapFile;
   llvm::StringRef outputFile;
+  llvm::StringRef partitionDir;
   llvm::StringRef optRemarksFilename;
   llvm::StringRef optRemarksPasses;
   llvm::StringRef optRemarksFormat;
@@ -107,6 +108,8 @@ struct Configuration {
   llvm::StringRef sysroot;
   llvm::StringRef thinLTOCacheDir;
   llvm::StringRef thinLTOIndexOnlyArg;
+  llvm::StringRef thinLTOSharedCacheDir;
+  llvm::StringRef timeTraceFile;
   std::pair<llvm::StringRef, llvm::StringRef> thinLTOObjectSuffixReplace;
   std::pair<llvm::StringRef, llvm::StringRef> thinLTOPrefixReplace;
   std::string rpath;
@@ -174,10 +177,14 @@ struct Configuration {
   bool pie;
   bool printGcSections;
   bool printIcfSections;
+  bool printMemoryUsage;
+  bool printSymbolOrderingStats;
   bool relocatable;
   bool relrPackDynRelocs;
   bool saveTemps;
+  bool showTiming;
   bool singleRoRx;
+  bool symbolOrderingFuzzy;
   bool shared;
   bool isStatic = false;
   bool sysvHash = false;
@@ -185,6 +192,7 @@ struct Configuration {
   bool trace;
   bool thinLTOEmitImportsFiles;
   bool thinLTOIndexOnly;
+  bool timeTraceEnabled;
   bool tocOptimize;
   bool undefinedVersion;
   bool useAndroidRelrTags = false;
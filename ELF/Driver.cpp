@@ -44,12 +44,14 @@
 #include "lld/Common/Strings.h"
 #include "lld/Common/TargetOptionsCommandFlags.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compression.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/GlobPattern.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
@@ -73,6 +75,13 @@ LinkerDriver *elf::driver;
 
 static void setConfigs(opt::InputArgList &args);
 static void readConfigs(opt::InputArgList &args);
+static void printMemoryUsage();
+static void writeTimeTraceFile();
+
+static Timer inputFileTimer("Input File Reading", Timer::root());
+static Timer symbolResolutionTimer("Symbol Resolution", Timer::root());
+static Timer ltoTimer("LTO", Timer::root());
+static Timer comdatTimer("COMDAT Deduplication", symbolResolutionTimer);
 
 bool elf::link(ArrayRef<const char *> args, bool canExitEarly,
                raw_ostream &error) {
@@ -85,6 +94,8 @@ bool elf::link(ArrayRef<const char *> args, bool canExitEarly,
   errorHandler().colorDiagnostics = error.has_colors();
 
   inputSections.clear();
+  dependentSectionMap.clear();
+  symAux.clear();
   outputSections.clear();
   binaryFiles.clear();
   bitcodeFiles.clear();
@@ -105,7 +116,19 @@ bool elf::link(ArrayRef<const char *> args, bool canExitEarly,
 
   config->progName = args[0];
 
-  driver->main(args);
+  {
+    ScopedTimer t(Timer::root());
+    driver->main(args);
+  }
+  waitForThinLTOCachePruning();
+
+  // Handle --time and --time-trace.
+  if (config->timeTraceEnabled)
+    writeTimeTraceFile();
+  if (config->showTiming)
+    Timer::root().print();
+  if (config->printMemoryUsage)
+    printMemoryUsage();
 
   // Exit immediately if we don't need to return to the caller.
   // This saves time because the overhead of calling destructors
@@ -117,6 +140,37 @@ bool elf::link(ArrayRef<const char *> args, bool canExitEarly,
   return !errorCount();
 }
 
+// Prints the memory used by the linker for --print-memory-usage. Most of
+// it is in arenas, which we break down by object type. Side tables that
+// keep rarely used fields out of symbols and sections are listed too.
+static void printMemoryUsage() {
+  std::string s;
+  raw_string_ostream os(s);
+  os << "Memory usage:\n";
+  os << format("%-33s%12zu bytes\n", "Symbol auxiliary entries:",
+               symAux.capacity() * sizeof(SymbolAux));
+  os << format("%-33s%12zu bytes\n", "Dependent section lists:",
+               dependentSectionMap.getMemorySize());
+  printArenaUsage(os);
+  message(StringRef(os.str()).rtrim());
+}
+
+// Writes the spans recorded for --time-trace. Unless --time-trace-file is
+// given, the trace goes next to the output file.
+static void writeTimeTraceFile() {
+  std::string path = config->timeTraceFile;
+  if (path.empty())
+    path = (config->outputFile + ".time-trace").str();
+
+  std::error_code ec;
+  raw_fd_ostream os(path, ec, fs::F_None);
+  if (ec) {
+    error("cannot open " + path + ": " + ec.message());
+    return;
+  }
+  writeTimeTrace(os);
+}
+
 // Parses a linker -m option.
 static std::tuple<ELFKind, uint16_t, uint8_t> parseEmulation(StringRef emul) {
   uint8_t osabi = 0;
@@ -450,7 +504,10 @@ void LinkerDriver::main(ArrayRef<const char *> argsArr) {
     return;
 
   initLLVM();
-  createFiles(args);
+  {
+    ScopedTimer t(inputFileTimer);
+    createFiles(args);
+  }
   if (errorCount())
     return;
 
@@ -788,7 +845,26 @@ static void readConfigs(opt::InputArgList &args) {
       args.hasFlag(OPT_fatal_warnings, OPT_no_fatal_warnings, false);
   errorHandler().vsDiagnostics =
       args.hasArg(OPT_visual_studio_diagnostics_format, false);
-  threadsEnabled = args.hasFlag(OPT_threads, OPT_no_threads, true);
+  // The last of the thread options wins.
+  threadsEnabled = true;
+  threadCount = 0;
+  if (auto *arg =
+          args.getLastArg(OPT_threads, OPT_no_threads, OPT_threads_eq)) {
+    if (arg->getOption().getID() == OPT_threads_eq) {
+      StringRef v = arg->getValue();
+      if (!to_integer(v, threadCount, 10) || threadCount == 0)
+        error("--threads: expected a positive integer, but got '" + v + "'");
+      threadsEnabled = threadCount > 1;
+    } else {
+      threadsEnabled = arg->getOption().getID() == OPT_threads;
+    }
+  }
+  if (auto *arg = args.getLastArg(OPT_thread_affinity))
+    setThreadAffinity(arg->getValue());
+  for (auto *arg : args.filtered(OPT_phase_threads))
+    setPhaseThreads(arg->getValue());
+  timeTraceEnabled =
+      args.hasArg(OPT_time_trace) || args.hasArg(OPT_time_trace_file);
 
   config->allowMultipleDefinition =
       args.hasFlag(OPT_allow_multiple_definition,
@@ -866,12 +942,16 @@ static void readConfigs(opt::InputArgList &args) {
   config->optimize = args::getInteger(args, OPT_O, 1);
   config->orphanHandling = getOrphanHandling(args);
   config->outputFile = args.getLastArgValue(OPT_o);
+  config->partitionDir = args.getLastArgValue(OPT_partition_dir);
   config->pacPlt = args.hasArg(OPT_pac_plt);
   config->pie = args.hasFlag(OPT_pie, OPT_no_pie, false);
   config->printIcfSections =
       args.hasFlag(OPT_print_icf_sections, OPT_no_print_icf_sections, false);
   config->printGcSections =
       args.hasFlag(OPT_print_gc_sections, OPT_no_print_gc_sections, false);
+  config->printMemoryUsage = args.hasArg(OPT_print_memory_usage);
+  config->printSymbolOrderingStats =
+      args.hasArg(OPT_print_symbol_ordering_stats);
   config->printSymbolOrder =
       args.getLastArgValue(OPT_print_symbol_order);
   config->rpath = getRpath(args);
@@ -880,7 +960,11 @@ static void readConfigs(opt::InputArgList &args) {
   config->searchPaths = args::getStrings(args, OPT_library_path);
   config->sectionStartMap = getSectionStartMap(args);
   config->shared = args.hasArg(OPT_shared);
+  config->showTiming = args.hasArg(OPT_show_timing);
   config->singleRoRx = args.hasArg(OPT_no_rosegment);
+  config->symbolOrderingFuzzy =
+      args.hasFlag(OPT_symbol_ordering_fuzzy, OPT_no_symbol_ordering_fuzzy,
+                   false);
   config->soName = args.getLastArgValue(OPT_soname);
   config->sortSection = getSortSection(args);
   config->splitStackAdjustSize = args::getInteger(args, OPT_split_stack_adjust_size, 16384);
@@ -903,6 +987,10 @@ static void readConfigs(opt::InputArgList &args) {
       getOldNewOptions(args, OPT_plugin_opt_thinlto_object_suffix_replace_eq);
   config->thinLTOPrefixReplace =
       getOldNewOptions(args, OPT_plugin_opt_thinlto_prefix_replace_eq);
+  config->thinLTOSharedCacheDir =
+      args.getLastArgValue(OPT_thinlto_shared_cache_dir);
+  config->timeTraceEnabled = timeTraceEnabled;
+  config->timeTraceFile = args.getLastArgValue(OPT_time_trace_file);
   config->trace = args.hasArg(OPT_trace);
   config->undefined = args::getStrings(args, OPT_undefined);
   config->undefinedVersion =
@@ -1510,6 +1598,14 @@ static void readSymbolPartitionSection(InputSectionBase *s) {
   if (config->emachine == EM_MIPS)
     error(toString(s->file) + ": partitions cannot be used on this target");
 
+  // With --partition-dir, a partition is written to a file named after it,
+  // so its name must not escape the directory.
+  if (!config->partitionDir.empty() &&
+      (partName.empty() || partName == "." || partName == ".." ||
+       partName.find_first_of("/\\") != StringRef::npos))
+    error(toString(s->file) + ": invalid partition name for --partition-dir: " +
+          partName);
+
   // Impose a limit of no more than 254 partitions. This limit comes from the
   // sizes of the Partition fields in InputSectionBase and Symbol, as well as
   // the amount of space devoted to the partition number in RankFlags.
@@ -1535,18 +1631,20 @@ static Symbol *addUndefined(StringRef name) {
 // Because all bitcode files that the program consists of are passed to
 // the compiler at once, it can do a whole-program optimization.
 template <class ELFT> void LinkerDriver::compileBitcodeFiles() {
+  ScopedTimer t(ltoTimer);
+
   // Compile bitcode files and replace bitcode symbols.
   lto.reset(new BitcodeCompiler);
   for (BitcodeFile *file : bitcodeFiles)
     lto->add(*file);
 
-  for (InputFile *file : lto->compile()) {
+  lto->compile([](InputFile *file) {
     auto *obj = cast<ObjFile<ELFT>>(file);
     obj->parse(/*ignoreComdats=*/true);
     for (Symbol *sym : obj->getGlobalSymbols())
       sym->parseSymbolVersion();
     objectFiles.push_back(file);
-  }
+  });
 }
 
 // The --wrap option is a feature to rename symbols so that you can write
@@ -1702,6 +1800,15 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   for (auto *arg : args.filtered(OPT_trace_symbol))
     symtab->insert(arg->getValue())->traced = true;
 
+  ScopedTimer resolutionTimer(symbolResolutionTimer);
+
+  // Discard duplicate COMDAT groups of the input object files in parallel
+  // before parsing them. This is not needed for correctness.
+  {
+    ScopedTimer t(comdatTimer);
+    dedupComdatGroups(files);
+  }
+
   // Add all files to the symbol table. This will add almost all
   // symbols that we need to the symbol table. This process might
   // add files to the link, via autolinking, these files are always
@@ -1757,6 +1864,8 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
     for (const char *s : libcallRoutineNames)
       handleLibcall(s);
 
+  resolutionTimer.stop();
+
   // Return if there were name resolution errors.
   if (errorCount())
     return;
@@ -79,6 +79,7 @@
 #include "SyntheticSections.h"
 #include "Writer.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/BinaryFormat/ELF.h"
 #include "llvm/Object/ELF.h"
@@ -92,6 +93,8 @@ using namespace llvm;
 using namespace llvm::ELF;
 using namespace llvm::object;
 
+static Timer icfTimer("ICF", Timer::root());
+
 namespace {
 template <class ELFT> class ICF {
 public:
@@ -495,14 +498,17 @@ template <class ELFT> void ICF<ELFT>::run() {
       // At this point we know sections merged are fully identical and hence
       // we want to remove duplicate implicit dependencies such as link order
       // and relocation sections.
-      for (InputSection *isec : sections[i]->dependentSections)
+      for (InputSection *isec : sections[i]->getDependentSections())
         isec->markDead();
     }
   });
 }
 
 // ICF entry point function.
-template <class ELFT> void elf::doIcf() { ICF<ELFT>().run(); }
+template <class ELFT> void elf::doIcf() {
+  ScopedTimer t(icfTimer);
+  ICF<ELFT>().run();
+}
 
 template void elf::doIcf<ELF32LE>();
 template void elf::doIcf<ELF32BE>();
@@ -15,6 +15,7 @@
 #include "SyntheticSections.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
@@ -664,7 +665,7 @@ void ObjFile<ELFT>::initializeSections(bool ignoreComdats) {
               ": invalid sh_link index: " + Twine(sec.sh_link));
 
       InputSection *isec = cast<InputSection>(this->sections[i]);
-      linkSec->dependentSections.push_back(isec);
+      linkSec->addDependentSection(isec);
       if (!isa<InputSection>(linkSec))
         error("a section " + isec->name +
               " with SHF_LINK_ORDER should not refer a non-regular "
@@ -674,6 +675,139 @@ void ObjFile<ELFT>::initializeSections(bool ignoreComdats) {
   }
 }
 
+template <class ELFT>
+std::vector<typename ObjFile<ELFT>::ComdatGroup>
+ObjFile<ELFT>::getComdatGroups() const {
+  std::vector<ComdatGroup> ret;
+  if (this->justSymbols)
+    return ret;
+
+  // Errors are reported by parse(), so we just give up here.
+  const ELFFile<ELFT> &obj = this->getObj();
+  Expected<ArrayRef<Elf_Shdr>> objSections = obj.sections();
+  if (!objSections) {
+    consumeError(objSections.takeError());
+    return ret;
+  }
+
+  ArrayRef<Elf_Sym> symbols = this->template getELFSyms<ELFT>();
+  for (size_t i = 0, e = objSections->size(); i < e; ++i) {
+    const Elf_Shdr &sec = (*objSections)[i];
+    if (sec.sh_type != SHT_GROUP ||
+        ((sec.sh_flags & SHF_EXCLUDE) && !config->relocatable))
+      continue;
+
+    Expected<ArrayRef<Elf_Word>> entries =
+        obj.template getSectionContentsAsArray<Elf_Word>(&sec);
+    if (!entries) {
+      consumeError(entries.takeError());
+      continue;
+    }
+    if (entries->empty() || (*entries)[0] != GRP_COMDAT)
+      continue;
+
+    if (sec.sh_info >= symbols.size())
+      continue;
+    const Elf_Sym &sym = symbols[sec.sh_info];
+    Expected<StringRef> signature = sym.getName(this->stringTable);
+    if (!signature) {
+      consumeError(signature.takeError());
+      continue;
+    }
+    if (signature->empty())
+      continue;
+    ret.push_back({CachedHashStringRef(*signature), (uint32_t)i});
+  }
+  return ret;
+}
+
+template <class ELFT>
+void ObjFile<ELFT>::discardComdatGroup(uint32_t sectionIndex) {
+  const ELFFile<ELFT> &obj = this->getObj();
+  ArrayRef<Elf_Shdr> objSections = cantFail(obj.sections());
+  ArrayRef<Elf_Word> entries =
+      cantFail(obj.template getSectionContentsAsArray<Elf_Word>(
+          &objSections[sectionIndex]));
+
+  // Leave invalid groups to parse(), which reports them.
+  for (uint32_t secIndex : entries.slice(1))
+    if (secIndex >= objSections.size())
+      return;
+
+  this->sections.resize(objSections.size());
+  this->sections[sectionIndex] = &InputSection::discarded;
+  for (uint32_t secIndex : entries.slice(1))
+    this->sections[secIndex] = &InputSection::discarded;
+}
+
+// Object files given on the command line are always parsed in command line
+// order, so for each COMDAT signature we can tell before parsing that all
+// but the first of their groups will lose. (The first one may still lose to
+// a group in a bitcode file or an archive member that is parsed earlier,
+// which parse() handles as usual.) Doing it up front lets us read the group
+// signatures in parallel, and the sections of losing groups are never
+// created.
+template <class ELFT>
+static void doDedupComdatGroups(ArrayRef<InputFile *> files) {
+  std::vector<ObjFile<ELFT> *> objs;
+  for (InputFile *file : files)
+    if (auto *obj = dyn_cast<ObjFile<ELFT>>(file))
+      if (obj->ekind == config->ekind && obj->emachine == config->emachine)
+        objs.push_back(obj);
+  if (objs.size() < 2)
+    return;
+
+  using ComdatGroup = typename ObjFile<ELFT>::ComdatGroup;
+  std::vector<std::vector<ComdatGroup>> groups(objs.size());
+  parallelForEachN(0, objs.size(),
+                   [&](size_t i) { groups[i] = objs[i]->getComdatGroups(); });
+
+  // Shard the groups by signature hash, keeping the file order within each
+  // shard, so that each shard can find its duplicates independently.
+  const size_t numShards = 256;
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> shards(numShards);
+  for (size_t i = 0, e = objs.size(); i < e; ++i)
+    for (size_t j = 0, f = groups[i].size(); j < f; ++j)
+      shards[groups[i][j].signature.hash() % numShards].push_back({i, j});
+
+  std::vector<std::vector<uint8_t>> isDuplicate(objs.size());
+  for (size_t i = 0, e = objs.size(); i < e; ++i)
+    isDuplicate[i].resize(groups[i].size());
+
+  parallelForEachN(0, numShards, [&](size_t shard) {
+    DenseSet<CachedHashStringRef> seen;
+    for (std::pair<uint32_t, uint32_t> p : shards[shard])
+      if (!seen.insert(groups[p.first][p.second].signature).second)
+        isDuplicate[p.first][p.second] = true;
+  });
+
+  parallelForEachN(0, objs.size(), [&](size_t i) {
+    for (size_t j = 0, e = groups[i].size(); j < e; ++j)
+      if (isDuplicate[i][j])
+        objs[i]->discardComdatGroup(groups[i][j].sectionIndex);
+  });
+}
+
+void elf::dedupComdatGroups(ArrayRef<InputFile *> files) {
+  switch (config->ekind) {
+  case ELF32LEKind:
+    doDedupComdatGroups<ELF32LE>(files);
+    return;
+  case ELF32BEKind:
+    doDedupComdatGroups<ELF32BE>(files);
+    return;
+  case ELF64LEKind:
+    doDedupComdatGroups<ELF64LE>(files);
+    return;
+  case ELF64BEKind:
+    doDedupComdatGroups<ELF64BE>(files);
+    return;
+  default:
+    // There are no ELF input files.
+    return;
+  }
+}
+
 // For ARM only, to set the EF_ARM_ABI_FLOAT_SOFT or EF_ARM_ABI_FLOAT_HARD
 // flag in the ELF Header we need to look at Tag_ABI_VFP_args to find out how
 // the input objects have been compiled.
@@ -911,7 +1045,7 @@ InputSectionBase *ObjFile<ELFT>::createInputSection(const Elf_Shdr &sec) {
       // contains the "/DISCARD/". It is perhaps uncommon to use a script with
       // -r, but we faced it in the Linux kernel and have to handle such case
       // and not to crash.
-      target->dependentSections.push_back(relocSec);
+      target->addDependentSection(relocSec);
       return relocSec;
     }
 
@@ -949,7 +1083,7 @@ InputSectionBase *ObjFile<ELFT>::createInputSection(const Elf_Shdr &sec) {
     if (config->emitRelocs) {
       InputSection *relocSec = make<InputSection>(*this, sec, name);
       // We will not emit relocation section if target was discarded.
-      target->dependentSections.push_back(relocSec);
+      target->addDependentSection(relocSec);
       return relocSec;
     }
     return nullptr;
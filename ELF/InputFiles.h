@@ -57,6 +57,9 @@ llvm::Optional<MemoryBufferRef> readFile(StringRef path);
 // Add symbols in File to the symbol table.
 void parseFile(InputFile *file);
 
+// Discards duplicate COMDAT groups of the given files before they are parsed.
+void dedupComdatGroups(ArrayRef<InputFile *> files);
+
 // The root class of input files.
 class InputFile {
 public:
@@ -210,6 +213,22 @@ public:
   StringRef getShtGroupSignature(ArrayRef<Elf_Shdr> sections,
                                  const Elf_Shdr &sec);
 
+  // A COMDAT group identified by its signature and the index of its
+  // SHT_GROUP section.
+  struct ComdatGroup {
+    llvm::CachedHashStringRef signature;
+    uint32_t sectionIndex;
+  };
+
+  // Returns the COMDAT groups of this file without parsing it. Unlike
+  // parse(), this is thread-safe. Groups that parse() would reject or that
+  // use a section name as a signature are not returned.
+  std::vector<ComdatGroup> getComdatGroups() const;
+
+  // Marks a COMDAT group and its members as discarded, so that parse()
+  // skips them.
+  void discardComdatGroup(uint32_t sectionIndex);
+
   Symbol &getSymbol(uint32_t symbolIndex) const {
     if (symbolIndex >= this->symbols.size())
       fatal(toString(this) + ": invalid symbol index");
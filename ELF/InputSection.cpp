@@ -41,6 +41,8 @@ using namespace lld;
 using namespace lld::elf;
 
 std::vector<InputSectionBase *> elf::inputSections;
+DenseMap<const InputSectionBase *, TinyPtrVector<InputSection *>>
+    elf::dependentSectionMap;
 
 // Returns a string to construct an error message.
 std::string lld::toString(const InputSectionBase *sec) {
@@ -137,13 +139,14 @@ InputSectionBase::InputSectionBase(ObjFile<ELFT> &file,
 size_t InputSectionBase::getSize() const {
   if (auto *s = dyn_cast<SyntheticSection>(this))
     return s->getSize();
-  if (uncompressedSize >= 0)
-    return uncompressedSize;
+  if (compressed)
+    return readCompressedHeader().second;
   return rawData.size();
 }
 
 void InputSectionBase::uncompress() const {
-  size_t size = uncompressedSize;
+  size_t hdrSize, size;
+  std::tie(hdrSize, size) = readCompressedHeader();
   char *uncompressedBuf;
   {
     static std::mutex mu;
@@ -151,11 +154,25 @@ void InputSectionBase::uncompress() const {
     uncompressedBuf = bAlloc.Allocate<char>(size);
   }
 
-  if (Error e = zlib::uncompress(toStringRef(rawData), uncompressedBuf, size))
+  if (Error e = zlib::uncompress(toStringRef(rawData.slice(hdrSize)),
+                                 uncompressedBuf, size))
     fatal(toString(this) +
           ": uncompress failed: " + llvm::toString(std::move(e)));
   rawData = makeArrayRef((uint8_t *)uncompressedBuf, size);
-  uncompressedSize = -1;
+  compressed = false;
+}
+
+ArrayRef<InputSection *> InputSectionBase::getDependentSections() const {
+  if (dependentSectionMap.empty())
+    return {};
+  auto it = dependentSectionMap.find(this);
+  if (it == dependentSectionMap.end())
+    return {};
+  return it->second;
+}
+
+void InputSectionBase::addDependentSection(InputSection *isec) {
+  dependentSectionMap[this].push_back(isec);
 }
 
 uint64_t InputSectionBase::getOffsetInFile() const {
@@ -207,8 +224,9 @@ OutputSection *SectionBase::getOutputSection() {
 }
 
 // When a section is compressed, `rawData` consists with a header followed
-// by zlib-compressed data. This function parses a header to initialize
-// `uncompressedSize` member and remove the header from `rawData`.
+// by zlib-compressed data. This function validates a header and marks the
+// section as compressed. The header is kept in `rawData` so that we don't
+// need to store the uncompressed size in each section.
 void InputSectionBase::parseCompressedHeader() {
   using Chdr64 = typename ELF64LE::Chdr;
   using Chdr32 = typename ELF32LE::Chdr;
@@ -219,15 +237,13 @@ void InputSectionBase::parseCompressedHeader() {
       error(toString(this) + ": corrupted compressed section header");
       return;
     }
-    rawData = rawData.slice(4);
 
-    if (rawData.size() < 8) {
+    if (rawData.size() < 12) {
       error(toString(this) + ": corrupted compressed section header");
       return;
     }
 
-    uncompressedSize = read64be(rawData.data());
-    rawData = rawData.slice(8);
+    compressed = true;
 
     // Restore the original section name.
     // (e.g. ".zdebug_info" -> ".debug_info")
@@ -251,9 +267,8 @@ void InputSectionBase::parseCompressedHeader() {
       return;
     }
 
-    uncompressedSize = hdr->ch_size;
+    compressed = true;
     alignment = std::max<uint32_t>(hdr->ch_addralign, 1);
-    rawData = rawData.slice(sizeof(*hdr));
     return;
   }
 
@@ -269,9 +284,26 @@ void InputSectionBase::parseCompressedHeader() {
     return;
   }
 
-  uncompressedSize = hdr->ch_size;
+  compressed = true;
   alignment = std::max<uint32_t>(hdr->ch_addralign, 1);
-  rawData = rawData.slice(sizeof(*hdr));
+}
+
+// Returns the size of the compression header at the beginning of `rawData`
+// and the uncompressed size of the section contents. The header has already
+// been validated by parseCompressedHeader().
+std::pair<size_t, size_t> InputSectionBase::readCompressedHeader() const {
+  assert(compressed);
+
+  // Old-style header: "ZLIB" followed by a 64-bit big-endian size.
+  if (toStringRef(rawData).startswith("ZLIB"))
+    return {12, read64be(rawData.data() + 4)};
+
+  if (config->is64) {
+    auto *hdr = reinterpret_cast<const ELF64LE::Chdr *>(rawData.data());
+    return {sizeof(*hdr), hdr->ch_size};
+  }
+  auto *hdr = reinterpret_cast<const ELF32LE::Chdr *>(rawData.data());
+  return {sizeof(*hdr), hdr->ch_size};
 }
 
 InputSection *InputSectionBase::getLinkOrderDep() const {
@@ -1109,9 +1141,10 @@ template <class ELFT> void InputSection::writeTo(uint8_t *buf) {
 
   // If this is a compressed section, uncompress section contents directly
   // to the buffer.
-  if (uncompressedSize >= 0) {
-    size_t size = uncompressedSize;
-    if (Error e = zlib::uncompress(toStringRef(rawData),
+  if (compressed) {
+    size_t hdrSize, size;
+    std::tie(hdrSize, size) = readCompressedHeader();
+    if (Error e = zlib::uncompress(toStringRef(rawData.slice(hdrSize)),
                                    (char *)(buf + outSecOff), size))
       fatal(toString(this) +
             ": uncompress failed: " + llvm::toString(std::move(e)));
@@ -1136,7 +1169,7 @@ void InputSection::replace(InputSection *other) {
   // able to access it.
   if (partition != other->partition) {
     partition = 1;
-    for (InputSection *isec : dependentSections)
+    for (InputSection *isec : getDependentSections())
       isec->partition = 1;
   }
 
@@ -14,6 +14,7 @@
 #include "Thunks.h"
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Object/ELF.h"
@@ -54,7 +55,7 @@ public:
 
   unsigned sectionKind : 3;
 
-  // The next three bit fields are only used by InputSectionBase, but we
+  // The next four bit fields are only used by InputSectionBase, but we
   // put them here so the struct packs better.
 
   // True if this section has already been placed to a linker script
@@ -75,6 +76,10 @@ public:
   // Set for sections that should not be folded by ICF.
   unsigned keepUnique : 1;
 
+  // True if the contents of this section are still compressed. See
+  // InputSectionBase::parseCompressedHeader().
+  mutable unsigned compressed : 1;
+
   // The 1-indexed partition that this section is assigned to by the garbage
   // collector, or 0 if this section is dead. Normally there is only one
   // partition, so this will either be 0 or 1.
@@ -109,7 +114,8 @@ protected:
               uint64_t entsize, uint64_t alignment, uint32_t type,
               uint32_t info, uint32_t link)
       : name(name), repl(this), sectionKind(sectionKind), assigned(false),
-        bss(false), keepUnique(false), partition(0), alignment(alignment),
+        bss(false), keepUnique(false), compressed(false), partition(0),
+        alignment(alignment),
         flags(flags), entsize(entsize), type(type), link(link), info(info) {}
 };
 
@@ -142,7 +148,7 @@ public:
   }
 
   ArrayRef<uint8_t> data() const {
-    if (uncompressedSize >= 0)
+    if (compressed)
       uncompress();
     return rawData;
   }
@@ -169,8 +175,11 @@ public:
         numRelocations);
   }
 
-  // InputSections that are dependent on us (reverse dependency for GC)
-  llvm::TinyPtrVector<InputSection *> dependentSections;
+  // InputSections that are dependent on us (reverse dependency for GC).
+  // Few sections have any, so they are kept out of line in
+  // dependentSectionMap.
+  ArrayRef<InputSection *> getDependentSections() const;
+  void addDependentSection(InputSection *isec);
 
   // Returns the size of this section (even if this is a common or BSS.)
   size_t getSize() const;
@@ -216,14 +225,12 @@ public:
 protected:
   void parseCompressedHeader();
   void uncompress() const;
+  std::pair<size_t, size_t> readCompressedHeader() const;
 
+  // If `compressed` is true, this is the compressed data including its
+  // header, which is parsed again on uncompression instead of keeping
+  // the uncompressed size in every section.
   mutable ArrayRef<uint8_t> rawData;
-
-  // This field stores the uncompressed size of the compressed data in rawData,
-  // or -1 if rawData is not compressed (either because the section wasn't
-  // compressed in the first place, or because we ended up uncompressing it).
-  // Since the feature is not used often, this is usually -1.
-  mutable int64_t uncompressedSize = -1;
 };
 
 // SectionPiece represents a piece of splittable section contents.
@@ -366,9 +373,23 @@ private:
   template <class ELFT> void copyShtGroup(uint8_t *buf);
 };
 
+// We allocate one InputSection for each section of each input file, so it is
+// important to keep the class small. MSVC does not pack SectionBase's fields
+// as tightly as the Itanium ABI does.
+#ifdef _WIN32
+static_assert(sizeof(InputSection) <= 160, "InputSection is too big");
+#else
+static_assert(sizeof(InputSection) <= 144, "InputSection is too big");
+#endif
+
 // The list of all input sections.
 extern std::vector<InputSectionBase *> inputSections;
 
+// A map from sections to their dependent sections.
+extern llvm::DenseMap<const InputSectionBase *,
+                      llvm::TinyPtrVector<InputSection *>>
+    dependentSectionMap;
+
 } // namespace elf
 
 std::string toString(const elf::InputSectionBase *);
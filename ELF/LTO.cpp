@@ -15,6 +15,7 @@
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/TargetOptionsCommandFlags.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
@@ -31,11 +32,17 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 using namespace llvm;
@@ -228,31 +235,284 @@ static void thinLTOCreateEmptyIndexFiles() {
   }
 }
 
+namespace {
+// Keeps track of LTO backend tasks so that their outputs can be consumed in
+// task order while later tasks are still running.
+class TaskTracker {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  TaskTracker(size_t numTasks, size_t numRegularTasks)
+      : state(numTasks, Pending), startTime(numTasks), endTime(numTasks),
+        numRegularTasks(numRegularTasks) {}
+
+  // Called when a backend starts working on a task.
+  void start(size_t task) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (state[task] == Pending)
+      startTime[task] = Clock::now();
+    state[task] = Running;
+
+    // Regular LTO partitions are all done before the first ThinLTO task
+    // starts. Partitions that did not start by then have no output.
+    if (task >= numRegularTasks) {
+      for (size_t i = 0; i < numRegularTasks; ++i)
+        if (state[i] == Pending)
+          state[i] = Skipped;
+      cv.notify_all();
+    }
+  }
+
+  // Called when the output of a task is complete.
+  void finish(size_t task) {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      state[task] = Finished;
+      endTime[task] = Clock::now();
+    }
+    cv.notify_all();
+  }
+
+  // Called when LTO is over.
+  void finishAll() {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      allDone = true;
+    }
+    cv.notify_all();
+  }
+
+  // Waits until a task is finished or is known to never run.
+  void wait(size_t task) {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] {
+      return allDone || state[task] == Finished || state[task] == Skipped;
+    });
+  }
+
+  // Returns how long a finished task took.
+  Clock::duration getDuration(size_t task) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (state[task] != Finished)
+      return Clock::duration::zero();
+    return endTime[task] - startTime[task];
+  }
+
+private:
+  enum State { Pending, Running, Finished, Skipped };
+
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<State> state;
+  std::vector<Clock::time_point> startTime;
+  std::vector<Clock::time_point> endTime;
+  size_t numRegularTasks;
+  bool allDone = false;
+};
+
+// An output stream of an LTO backend task that notifies the tracker once
+// the task has written its native object.
+class TaskStream : public lto::NativeObjectStream {
+public:
+  TaskStream(TaskTracker &tracker, size_t task, SmallString<0> &buf)
+      : lto::NativeObjectStream(llvm::make_unique<raw_svector_ostream>(buf)),
+        tracker(tracker), task(task) {
+    tracker.start(task);
+  }
+
+  ~TaskStream() override {
+    OS.reset();
+    tracker.finish(task);
+  }
+
+private:
+  TaskTracker &tracker;
+  size_t task;
+};
+} // namespace
+
+namespace {
+// Statistics about the ThinLTO cache, printed with --verbose or --time.
+class CacheStats {
+public:
+  explicit CacheStats(size_t numTasks) : isMiss(numTasks) {}
+
+  void addHit(const MemoryBuffer &mb, bool shared) {
+    ++hits;
+    if (shared)
+      ++sharedHits;
+    bytesReused += mb.getBufferSize();
+  }
+
+  void addMiss(size_t task) {
+    ++misses;
+    isMiss[task] = true;
+  }
+
+  void print(TaskTracker &tracker) {
+    // We cannot know how long the backends for hits would have taken, so
+    // estimate it by the average time of the misses.
+    std::string saved = "unknown";
+    if (misses) {
+      TaskTracker::Clock::duration missTime{};
+      for (size_t i = 0; i < isMiss.size(); ++i)
+        if (isMiss[i])
+          missTime += tracker.getDuration(i);
+      int64_t ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(missTime)
+              .count();
+      saved = "~" + std::to_string(ms * hits / misses) + " ms";
+    }
+
+    std::string s = "ThinLTO cache: " + std::to_string(hits) + " hits (" +
+                    std::to_string(sharedHits) + " from shared cache), " +
+                    std::to_string(misses) + " misses, " +
+                    std::to_string(bytesReused) + " bytes reused, " + saved +
+                    " saved";
+    if (config->showTiming)
+      message(s);
+    else
+      log(s);
+  }
+
+private:
+  std::atomic<unsigned> hits{0};
+  std::atomic<unsigned> sharedHits{0};
+  std::atomic<unsigned> misses{0};
+  std::atomic<uint64_t> bytesReused{0};
+
+  // Each element is written only by the backend of its task.
+  std::vector<char> isMiss;
+};
+} // namespace
+
+// A thread pruning the ThinLTO cache while the rest of the link goes on.
+static std::thread cachePruner;
+
+void elf::waitForThinLTOCachePruning() {
+  if (cachePruner.joinable())
+    cachePruner.join();
+}
+
 // Merge all the bitcode files we have seen, codegen the result
-// and return the resulting ObjectFile(s).
-std::vector<InputFile *> BitcodeCompiler::compile() {
+// and hand the resulting ObjectFile(s) over to onObject.
+void BitcodeCompiler::compile(function_ref<void(InputFile *)> onObject) {
   unsigned maxTasks = ltoObj->getMaxTasks();
   buf.resize(maxTasks);
   files.resize(maxTasks);
 
+  TaskTracker tracker(maxTasks, config->ltoPartitions);
+  CacheStats stats(maxTasks);
+
+  lto::AddStreamFn addStream = [&](size_t task) {
+    return llvm::make_unique<TaskStream>(tracker, task, buf[task]);
+  };
+
   // The --thinlto-cache-dir option specifies the path to a directory in which
   // to cache native object files for ThinLTO incremental builds. If a path was
   // specified, configure LTO to use it as the cache directory.
+  // --thinlto-shared-cache-dir specifies a directory that is looked up first
+  // but never written to, such as a cache shared by a CI fleet.
   lto::NativeObjectCache cache;
-  if (!config->thinLTOCacheDir.empty())
-    cache = check(
-        lto::localCache(config->thinLTOCacheDir,
-                        [&](size_t task, std::unique_ptr<MemoryBuffer> mb) {
-                          files[task] = std::move(mb);
-                        }));
-
-  if (!bitcodeFiles.empty())
-    checkError(ltoObj->run(
-        [&](size_t task) {
-          return llvm::make_unique<lto::NativeObjectStream>(
-              llvm::make_unique<raw_svector_ostream>(buf[task]));
-        },
-        cache));
+  if (!config->thinLTOCacheDir.empty() ||
+      !config->thinLTOSharedCacheDir.empty()) {
+    lto::NativeObjectCache localCache;
+    if (!config->thinLTOCacheDir.empty())
+      localCache = check(
+          lto::localCache(config->thinLTOCacheDir,
+                          [&](size_t task, std::unique_ptr<MemoryBuffer> mb) {
+                            files[task] = std::move(mb);
+                            tracker.finish(task);
+                          }));
+
+    cache = [&, localCache](size_t task, StringRef key) -> lto::AddStreamFn {
+      tracker.start(task);
+
+      if (!config->thinLTOSharedCacheDir.empty()) {
+        SmallString<128> path;
+        sys::path::append(path, config->thinLTOSharedCacheDir,
+                          "llvmcache-" + key);
+        ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+            MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+        if (mbOrErr) {
+          stats.addHit(**mbOrErr, /*shared=*/true);
+          files[task] = std::move(*mbOrErr);
+          tracker.finish(task);
+          return nullptr;
+        }
+      }
+
+      if (localCache) {
+        // The local cache calls the AddBuffer callback before returning
+        // null if it has the object.
+        lto::AddStreamFn fn = localCache(task, key);
+        if (!fn) {
+          stats.addHit(*files[task], /*shared=*/false);
+          return nullptr;
+        }
+        stats.addMiss(task);
+        return fn;
+      }
+
+      stats.addMiss(task);
+      return addStream;
+    };
+  }
+
+  auto runLTO = [&] {
+    if (!bitcodeFiles.empty())
+      checkError(ltoObj->run(addStream, cache));
+    tracker.finishAll();
+  };
+
+  // Hands over the objects written to memory by LTO backends in task
+  // order, each as soon as its task is done. Objects that came from the
+  // cache are added after all of them, once LTO is over.
+  auto consume = [&] {
+    for (unsigned i = 0; i != maxTasks; ++i) {
+      tracker.wait(i);
+
+      // Write the object to disk right away if requested, instead of
+      // waiting for all tasks to finish.
+      if (!config->ltoObjPath.empty()) {
+        if (i == 0)
+          saveBuffer(buf[0], config->ltoObjPath);
+        else
+          saveBuffer(buf[i], config->ltoObjPath + Twine(i));
+      }
+      if (config->saveTemps) {
+        if (i == 0)
+          saveBuffer(buf[0], config->outputFile + ".lto.o");
+        else
+          saveBuffer(buf[i], config->outputFile + Twine(i) + ".lto.o");
+      }
+
+      if (!buf[i].empty())
+        onObject(createObjectFile(MemoryBufferRef(buf[i], "lto.tmp")));
+    }
+  };
+
+  if (config->thinLTOIndexOnly) {
+    runLTO();
+  } else {
+    // Parse the objects of finished tasks on a separate thread while the
+    // remaining ones are still being compiled. The consumer is the only
+    // thread that touches the symbol table until LTO is done.
+#if LLVM_ENABLE_THREADS
+    if (threadsEnabled) {
+      std::thread consumer(consume);
+      runLTO();
+      consumer.join();
+    } else {
+      runLTO();
+      consume();
+    }
+#else
+    runLTO();
+    consume();
+#endif
+  }
 
   // Emit empty index files for non-indexed files
   for (StringRef s : thinIndices) {
@@ -273,31 +533,30 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
     // distributed environment.
     if (indexFile)
       indexFile->close();
-    return {};
+    return;
   }
 
-  if (!config->thinLTOCacheDir.empty())
+  if (cache)
+    stats.print(tracker);
+
+  // Pruning the cache may take a while on a large cache directory, and
+  // nothing else in the link depends on it, so do it in the background.
+  if (!config->thinLTOCacheDir.empty()) {
+#if LLVM_ENABLE_THREADS
+    if (threadsEnabled)
+      cachePruner = std::thread(
+          [](std::string dir, CachePruningPolicy policy) {
+            pruneCache(dir, policy);
+          },
+          config->thinLTOCacheDir.str(), config->thinLTOCachePolicy);
+    else
+      pruneCache(config->thinLTOCacheDir, config->thinLTOCachePolicy);
+#else
     pruneCache(config->thinLTOCacheDir, config->thinLTOCachePolicy);
-
-  if (!config->ltoObjPath.empty()) {
-    saveBuffer(buf[0], config->ltoObjPath);
-    for (unsigned i = 1; i != maxTasks; ++i)
-      saveBuffer(buf[i], config->ltoObjPath + Twine(i));
+#endif
   }
 
-  if (config->saveTemps) {
-    saveBuffer(buf[0], config->outputFile + ".lto.o");
-    for (unsigned i = 1; i != maxTasks; ++i)
-      saveBuffer(buf[i], config->outputFile + Twine(i) + ".lto.o");
-  }
-
-  std::vector<InputFile *> ret;
-  for (unsigned i = 0; i != maxTasks; ++i)
-    if (!buf[i].empty())
-      ret.push_back(createObjectFile(MemoryBufferRef(buf[i], "lto.tmp")));
-
   for (std::unique_ptr<MemoryBuffer> &file : files)
     if (file)
-      ret.push_back(createObjectFile(*file));
-  return ret;
+      onObject(createObjectFile(*file));
 }
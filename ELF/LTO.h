@@ -22,6 +22,7 @@
 
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/raw_ostream.h"
 #include <memory>
@@ -46,7 +47,13 @@ public:
   ~BitcodeCompiler();
 
   void add(BitcodeFile &f);
-  std::vector<InputFile *> compile();
+
+  // Runs LTO and calls `onObject` for each resulting native object file in
+  // a deterministic order. Objects compiled by LTO backends are handed over
+  // as soon as their tasks finish, so that parsing them overlaps with code
+  // generation of the remaining tasks. `onObject` may therefore be called
+  // on a thread other than the caller's, but never concurrently.
+  void compile(llvm::function_ref<void(InputFile *)> onObject);
 
 private:
   std::unique_ptr<llvm::lto::LTO> ltoObj;
@@ -56,6 +63,11 @@ private:
   std::unique_ptr<llvm::raw_fd_ostream> indexFile;
   llvm::DenseSet<StringRef> thinIndices;
 };
+
+// Waits for the pruning of the ThinLTO cache that BitcodeCompiler::compile
+// starts in the background once LTO is done. This must be called before
+// the linker exits.
+void waitForThinLTOCachePruning();
 } // namespace elf
 } // namespace lld
 
@@ -370,6 +370,177 @@ static void sortInputSections(MutableArrayRef<InputSection *> vec,
   sortSections(vec, pat.sortOuter);
 }
 
+namespace {
+// A rule is one SectionPattern of an InputSectionDescription. Rules are
+// numbered in the order they appear in the SECTIONS command, which is the
+// order in which processSectionCommands() lets them claim sections.
+struct Rule {
+  const InputSectionDescription *cmd;
+  const SectionPattern *pat;
+
+  // True if the file pattern is "*", so that we don't need file names.
+  bool anyFile;
+
+  // True if a section that matches this rule is always claimed by it.
+  // That is not the case for ONLY_IF_RO and ONLY_IF_RW output sections,
+  // which may release their sections for later rules.
+  bool final;
+};
+
+// An index to find rules whose section pattern may match a given name.
+// Most patterns in real-world linker scripts are either plain names
+// (".text") or a name prefix followed by "*" (".text.*"). We look them up
+// by hashing instead of running glob matchers for each rule and section.
+class SectionPatternIndex {
+public:
+  void add(const InputSectionDescription *cmd, bool final);
+  void match(InputSectionBase *sec, StringRef filename,
+             SmallVectorImpl<unsigned> &ret) const;
+  bool needsFilenames() const;
+  size_t size() const { return rules.size(); }
+  const SectionPattern *getPattern(unsigned i) const { return rules[i].pat; }
+
+private:
+  std::vector<Rule> rules;
+  DenseMap<StringRef, SmallVector<unsigned, 1>> exact;
+  DenseMap<StringRef, SmallVector<unsigned, 1>> prefixes;
+  std::vector<size_t> prefixLengths;
+  std::vector<unsigned> others;
+};
+} // namespace
+
+static bool isGlobChar(char c) {
+  return c == '*' || c == '?' || c == '[' || c == '\\';
+}
+
+void SectionPatternIndex::add(const InputSectionDescription *cmd,
+                              bool final) {
+  ArrayRef<std::string> filePats = cmd->filePat.getPatterns();
+  bool anyFile = filePats.size() == 1 && filePats[0] == "*";
+
+  for (const SectionPattern &pat : cmd->sectionPatterns) {
+    unsigned id = rules.size();
+    rules.push_back({cmd, &pat, anyFile, final});
+
+    for (const std::string &str : pat.sectionPat.getPatterns()) {
+      StringRef s = str;
+      size_t pos = s.find_if(isGlobChar);
+      if (pos == StringRef::npos) {
+        exact[s].push_back(id);
+      } else if (pos == s.size() - 1 && s.back() == '*') {
+        StringRef prefix = s.drop_back();
+        prefixes[prefix].push_back(id);
+        if (!llvm::is_contained(prefixLengths, prefix.size()))
+          prefixLengths.push_back(prefix.size());
+      } else if (others.empty() || others.back() != id) {
+        others.push_back(id);
+      }
+    }
+  }
+  llvm::sort(prefixLengths);
+}
+
+bool SectionPatternIndex::needsFilenames() const {
+  return llvm::any_of(rules, [](const Rule &r) {
+    return !r.anyFile || !r.pat->excludedFilePat.getPatterns().empty();
+  });
+}
+
+// Appends IDs of rules that match a given section to Ret in the order
+// they are applied. Rules after the first final one are omitted because
+// they can never claim the section.
+void SectionPatternIndex::match(InputSectionBase *sec, StringRef filename,
+                                SmallVectorImpl<unsigned> &ret) const {
+  StringRef name = sec->name;
+
+  SmallVector<unsigned, 8> ids;
+  auto it = exact.find(name);
+  if (it != exact.end())
+    ids.append(it->second.begin(), it->second.end());
+
+  for (size_t len : prefixLengths) {
+    if (len > name.size())
+      break;
+    auto it = prefixes.find(name.substr(0, len));
+    if (it != prefixes.end())
+      ids.append(it->second.begin(), it->second.end());
+  }
+
+  for (unsigned id : others)
+    if (rules[id].pat->sectionPat.match(name))
+      ids.push_back(id);
+
+  llvm::sort(ids);
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  for (unsigned id : ids) {
+    const Rule &r = rules[id];
+    if (!r.anyFile && !r.cmd->filePat.match(filename))
+      continue;
+    if (r.pat->excludedFilePat.match(filename))
+      continue;
+    ret.push_back(id);
+    if (r.final)
+      return;
+  }
+}
+
+// Linker scripts for embedded systems may have hundreds of rules, and
+// programs may have millions of input sections, so matching each rule
+// against all sections is too slow. Instead, we visit each section once
+// in parallel and find rules that can claim it using an index. The result
+// is a list of candidate sections for each rule, which computeInputSections()
+// then filters by the sections' state at the time the rule is applied.
+void LinkerScript::buildSectionIndex() {
+  SectionPatternIndex index;
+  for (BaseCommand *base : sectionCommands)
+    if (auto *sec = dyn_cast<OutputSection>(base))
+      for (BaseCommand *sub : sec->sectionCommands)
+        if (auto *cmd = dyn_cast<InputSectionDescription>(sub))
+          index.add(cmd, sec->constraint == ConstraintKind::NoConstraint);
+
+  // File names are constructed once per file rather than once per rule.
+  DenseMap<InputFile *, std::string> filenames;
+  if (index.needsFilenames())
+    for (InputSectionBase *sec : inputSections)
+      if (filenames.find(sec->file) == filenames.end())
+        filenames[sec->file] = getFilename(sec->file);
+
+  std::vector<SmallVector<unsigned, 2>> matches(inputSections.size());
+  parallelForEachN(0, inputSections.size(), [&](size_t i) {
+    InputSectionBase *sec = inputSections[i];
+    if (!sec->isLive())
+      return;
+
+    // For -emit-relocs we have to ignore entries like
+    //   .rela.dyn : { *(.rela.data) }
+    // which are common because they are in the default bfd script.
+    // We do not ignore SHT_REL[A] linker-synthesized sections here because
+    // want to support scripts that do custom layout for them.
+    if (auto *isec = dyn_cast<InputSection>(sec))
+      if (isec->getRelocatedSection())
+        return;
+
+    StringRef filename;
+    auto it = filenames.find(sec->file);
+    if (it != filenames.end())
+      filename = it->second;
+    index.match(sec, filename, matches[i]);
+  });
+
+  std::vector<std::vector<InputSection *>> candidates(index.size());
+  for (size_t i = 0, e = inputSections.size(); i < e; ++i)
+    for (unsigned id : matches[i])
+      // It is safe to assume that Sec is an InputSection
+      // because mergeable or EH input sections have already been
+      // handled and eliminated.
+      candidates[id].push_back(cast<InputSection>(inputSections[i]));
+
+  sectionCandidates.clear();
+  for (size_t id = 0, e = index.size(); id < e; ++id)
+    sectionCandidates[index.getPattern(id)] = std::move(candidates[id]);
+}
+
 // Compute and remember which sections the InputSectionDescription matches.
 std::vector<InputSection *>
 LinkerScript::computeInputSections(const InputSectionDescription *cmd) {
@@ -379,29 +550,14 @@ LinkerScript::computeInputSections(const InputSectionDescription *cmd) {
   for (const SectionPattern &pat : cmd->sectionPatterns) {
     size_t sizeBefore = ret.size();
 
-    for (InputSectionBase *sec : inputSections) {
-      if (!sec->isLive() || sec->assigned)
-        continue;
+    auto it = sectionCandidates.find(&pat);
+    if (it == sectionCandidates.end())
+      continue;
 
-      // For -emit-relocs we have to ignore entries like
-      //   .rela.dyn : { *(.rela.data) }
-      // which are common because they are in the default bfd script.
-      // We do not ignore SHT_REL[A] linker-synthesized sections here because
-      // want to support scripts that do custom layout for them.
-      if (auto *isec = dyn_cast<InputSection>(sec))
-        if (isec->getRelocatedSection())
-          continue;
-
-      std::string filename = getFilename(sec->file);
-      if (!cmd->filePat.match(filename) ||
-          pat.excludedFilePat.match(filename) ||
-          !pat.sectionPat.match(sec->name))
+    for (InputSection *sec : it->second) {
+      if (!sec->isLive() || sec->assigned)
         continue;
-
-      // It is safe to assume that Sec is an InputSection
-      // because mergeable or EH input sections have already been
-      // handled and eliminated.
-      ret.push_back(cast<InputSection>(sec));
+      ret.push_back(sec);
       sec->assigned = true;
     }
 
@@ -426,7 +582,7 @@ void LinkerScript::discard(ArrayRef<InputSection *> v) {
 
     s->assigned = false;
     s->markDead();
-    discard(s->dependentSections);
+    discard(s->getDependentSections());
   }
 }
 
@@ -464,6 +620,8 @@ void LinkerScript::processSectionCommands() {
   ctx = deleter.get();
   ctx->outSec = aether;
 
+  buildSectionIndex();
+
   size_t i = 0;
   // Add input sections to output sections.
   for (BaseCommand *base : sectionCommands) {
@@ -220,12 +220,19 @@ class LinkerScript final {
 
   llvm::DenseMap<StringRef, OutputSection *> nameToOutputSection;
 
+  // A map from section patterns to input sections that they may claim,
+  // computed by buildSectionIndex(). Each list is in input order.
+  llvm::DenseMap<const SectionPattern *, std::vector<InputSection *>>
+      sectionCandidates;
+
   void addSymbol(SymbolAssignment *cmd);
   void assignSymbol(SymbolAssignment *cmd, bool inSec);
   void setDot(Expr e, const Twine &loc, bool inSec);
   void expandOutputSection(uint64_t size);
   void expandMemoryRegions(uint64_t size);
 
+  void buildSectionIndex();
+
   std::vector<InputSection *>
   computeInputSections(const InputSectionDescription *);
 
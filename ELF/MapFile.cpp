@@ -53,51 +53,65 @@ static void writeHeader(raw_ostream &os, uint64_t vma, uint64_t lma,
 
 // Returns a list of all symbols that we want to print out.
 static std::vector<Defined *> getSymbols() {
-  std::vector<Defined *> v;
-  for (InputFile *file : objectFiles)
+  std::vector<std::vector<Defined *>> v(objectFiles.size());
+  parallelForEachN(0, objectFiles.size(), [&](size_t i) {
+    InputFile *file = objectFiles[i];
     for (Symbol *b : file->getSymbols())
       if (auto *dr = dyn_cast<Defined>(b))
         if (!dr->isSection() && dr->section && dr->section->isLive() &&
             (dr->file == file || dr->needsPltAddr || dr->section->bss))
-          v.push_back(dr);
-  return v;
+          v[i].push_back(dr);
+  });
+
+  std::vector<Defined *> ret;
+  for (std::vector<Defined *> &syms : v)
+    ret.insert(ret.end(), syms.begin(), syms.end());
+  return ret;
 }
 
-// Returns a map from sections to their symbols.
+// Returns a map from sections to their symbols. Symbols are sorted later
+// when their sections are printed.
 static SymbolMapTy getSectionSyms(ArrayRef<Defined *> syms) {
   SymbolMapTy ret;
   for (Defined *dr : syms)
     ret[dr->section].push_back(dr);
-
-  // Sort symbols by address. We want to print out symbols in the
-  // order in the output file rather than the order they appeared
-  // in the input files.
-  for (auto &it : ret)
-    llvm::stable_sort(it.second, [](Defined *a, Defined *b) {
-      return a->getVA() < b->getVA();
-    });
   return ret;
 }
 
-// Construct a map from symbols to their stringified representations.
-// Demangling symbols (which is what toString() does) is slow, so
-// we do that in batch using parallel-for.
-static DenseMap<Symbol *, std::string>
-getSymbolStrings(ArrayRef<Defined *> syms) {
-  std::vector<std::string> str(syms.size());
-  parallelForEachN(0, syms.size(), [&](size_t i) {
-    raw_string_ostream os(str[i]);
-    OutputSection *osec = syms[i]->getOutputSection();
-    uint64_t vma = syms[i]->getVA();
-    uint64_t lma = osec ? osec->getLMA() + vma - osec->getVA(0) : 0;
-    writeHeader(os, vma, lma, syms[i]->getSize(), 1);
-    os << indent16 << toString(*syms[i]);
-  });
+// toString(InputFile *) computes a file's name on first use and caches it in
+// the file without locking. Fill the caches before formatting output in
+// parallel so that worker threads only read them.
+static void initFileNameCaches() {
+  for (InputFile *file : objectFiles)
+    toString(file);
+  for (InputFile *file : sharedFiles)
+    toString(file);
+  for (InputFile *file : binaryFiles)
+    toString(file);
+  for (InputFile *file : bitcodeFiles)
+    toString(file);
+}
 
-  DenseMap<Symbol *, std::string> ret;
-  for (size_t i = 0, e = syms.size(); i < e; ++i)
-    ret[syms[i]] = std::move(str[i]);
-  return ret;
+// Formats n chunks of output in parallel and writes them to os in order.
+// Only a window of chunks is kept in memory at once, so the output for a
+// large program doesn't need to fit in memory, and each window is written
+// as soon as it is complete.
+static void writeChunks(raw_ostream &os, size_t n,
+                        function_ref<void(raw_ostream &, size_t)> fn) {
+  size_t window = std::max(getThreadLimit(), 1U) * 16;
+  std::vector<std::string> bufs(window);
+
+  for (size_t begin = 0; begin < n; begin += window) {
+    size_t end = std::min(begin + window, n);
+    parallelForEachN(begin, end, [&](size_t i) {
+      raw_string_ostream s(bufs[i - begin]);
+      fn(s, i);
+    });
+    for (size_t i = begin; i < end; ++i) {
+      os << bufs[i - begin];
+      bufs[i - begin].clear();
+    }
+  }
 }
 
 // Print .eh_frame contents. Since the section consists of EhSectionPieces,
@@ -139,6 +153,111 @@ static void printEhFrame(raw_ostream &os, const EhFrameSection *sec) {
   }
 }
 
+// A unit of the map file that is formatted independently: an output
+// section header, a run of input sections of an input section description,
+// or a single command. Runs of input sections are limited in length so
+// that a large output section is spread over many threads.
+namespace {
+struct MapChunk {
+  OutputSection *osec;
+  BaseCommand *cmd;
+  size_t begin = 0;
+  size_t end = 0;
+  bool inSec = false;
+};
+} // namespace
+
+static const size_t sectionsPerChunk = 256;
+
+static std::vector<MapChunk> getMapChunks() {
+  std::vector<MapChunk> v;
+  OutputSection *osec = nullptr;
+  for (BaseCommand *base : script->sectionCommands) {
+    if (isa<SymbolAssignment>(base)) {
+      v.push_back({osec, base});
+      continue;
+    }
+
+    osec = cast<OutputSection>(base);
+    v.push_back({osec, osec});
+    for (BaseCommand *base : osec->sectionCommands) {
+      auto *isd = dyn_cast<InputSectionDescription>(base);
+      if (!isd) {
+        v.push_back({osec, base, 0, 0, true});
+        continue;
+      }
+      for (size_t i = 0, e = isd->sections.size(); i < e;
+           i += sectionsPerChunk)
+        v.push_back({osec, isd, i, std::min(i + sectionsPerChunk, e)});
+    }
+  }
+  return v;
+}
+
+static void writeSymbol(raw_ostream &os, Defined *sym) {
+  OutputSection *osec = sym->getOutputSection();
+  uint64_t vma = sym->getVA();
+  uint64_t lma = osec ? osec->getLMA() + vma - osec->getVA(0) : 0;
+  writeHeader(os, vma, lma, sym->getSize(), 1);
+  os << indent16 << toString(*sym) << '\n';
+}
+
+static void writeMapChunk(raw_ostream &os, const MapChunk &chunk,
+                          SymbolMapTy &sectionSyms) {
+  OutputSection *osec = chunk.osec;
+
+  if (auto *cmd = dyn_cast<SymbolAssignment>(chunk.cmd)) {
+    if (cmd->provide && !cmd->sym)
+      return;
+    uint64_t lma = osec ? osec->getLMA() + cmd->addr - osec->getVA(0) : 0;
+    writeHeader(os, cmd->addr, lma, cmd->size, 1);
+    if (chunk.inSec)
+      os << indent8;
+    os << cmd->commandString << '\n';
+    return;
+  }
+
+  if (chunk.cmd == osec) {
+    writeHeader(os, osec->addr, osec->getLMA(), osec->size, osec->alignment);
+    os << osec->name << '\n';
+    return;
+  }
+
+  if (auto *cmd = dyn_cast<ByteCommand>(chunk.cmd)) {
+    writeHeader(os, osec->addr + cmd->offset, osec->getLMA() + cmd->offset,
+                cmd->size, 1);
+    os << indent8 << cmd->commandString << '\n';
+    return;
+  }
+
+  // Dump symbols for each input section.
+  auto *isd = cast<InputSectionDescription>(chunk.cmd);
+  for (size_t i = chunk.begin; i < chunk.end; ++i) {
+    InputSection *isec = isd->sections[i];
+    if (auto *ehSec = dyn_cast<EhFrameSection>(isec)) {
+      printEhFrame(os, ehSec);
+      continue;
+    }
+
+    writeHeader(os, isec->getVA(0), osec->getLMA() + isec->getOffset(0),
+                isec->getSize(), isec->alignment);
+    os << indent8 << toString(isec) << '\n';
+
+    auto it = sectionSyms.find(isec);
+    if (it == sectionSyms.end())
+      continue;
+
+    // Sort symbols by address. We want to print out symbols in the
+    // order in the output file rather than the order they appeared
+    // in the input files.
+    llvm::stable_sort(it->second, [](Defined *a, Defined *b) {
+      return a->getVA() < b->getVA();
+    });
+    for (Defined *sym : it->second)
+      writeSymbol(os, sym);
+  }
+}
+
 void elf::writeMapFile() {
   if (config->mapFile.empty())
     return;
@@ -152,69 +271,24 @@ void elf::writeMapFile() {
   }
 
   // Collect symbol info that we want to print out.
-  std::vector<Defined *> syms = getSymbols();
-  SymbolMapTy sectionSyms = getSectionSyms(syms);
-  DenseMap<Symbol *, std::string> symStr = getSymbolStrings(syms);
+  SymbolMapTy sectionSyms = getSectionSyms(getSymbols());
 
   // Print out the header line.
   int w = config->is64 ? 16 : 8;
   os << right_justify("VMA", w) << ' ' << right_justify("LMA", w)
      << "     Size Align Out     In      Symbol\n";
 
-  OutputSection* osec = nullptr;
-  for (BaseCommand *base : script->sectionCommands) {
-    if (auto *cmd = dyn_cast<SymbolAssignment>(base)) {
-      if (cmd->provide && !cmd->sym)
-        continue;
-      uint64_t lma = osec ? osec->getLMA() + cmd->addr - osec->getVA(0) : 0;
-      writeHeader(os, cmd->addr, lma, cmd->size, 1);
-      os << cmd->commandString << '\n';
-      continue;
-    }
-
-    osec = cast<OutputSection>(base);
-    writeHeader(os, osec->addr, osec->getLMA(), osec->size, osec->alignment);
-    os << osec->name << '\n';
-
-    // Dump symbols for each input section.
-    for (BaseCommand *base : osec->sectionCommands) {
-      if (auto *isd = dyn_cast<InputSectionDescription>(base)) {
-        for (InputSection *isec : isd->sections) {
-          if (auto *ehSec = dyn_cast<EhFrameSection>(isec)) {
-            printEhFrame(os, ehSec);
-            continue;
-          }
-
-          writeHeader(os, isec->getVA(0), osec->getLMA() + isec->getOffset(0),
-                      isec->getSize(), isec->alignment);
-          os << indent8 << toString(isec) << '\n';
-          for (Symbol *sym : sectionSyms[isec])
-            os << symStr[sym] << '\n';
-        }
-        continue;
-      }
-
-      if (auto *cmd = dyn_cast<ByteCommand>(base)) {
-        writeHeader(os, osec->addr + cmd->offset, osec->getLMA() + cmd->offset,
-                    cmd->size, 1);
-        os << indent8 << cmd->commandString << '\n';
-        continue;
-      }
-
-      if (auto *cmd = dyn_cast<SymbolAssignment>(base)) {
-        if (cmd->provide && !cmd->sym)
-          continue;
-        writeHeader(os, cmd->addr, osec->getLMA() + cmd->addr - osec->getVA(0),
-                    cmd->size, 1);
-        os << indent8 << cmd->commandString << '\n';
-        continue;
-      }
-    }
-  }
+  // Demangling symbols (which is what toString() does) is slow, so each
+  // chunk of the map file is formatted in parallel.
+  std::vector<MapChunk> chunks = getMapChunks();
+  initFileNameCaches();
+  writeChunks(os, chunks.size(), [&](raw_ostream &s, size_t i) {
+    writeMapChunk(s, chunks[i], sectionSyms);
+  });
 }
 
-static void print(StringRef a, StringRef b) {
-  outs() << left_justify(a, 49) << " " << b << "\n";
+static void print(raw_ostream &os, StringRef a, StringRef b) {
+  os << left_justify(a, 49) << " " << b << "\n";
 }
 
 // Output a cross reference table to stdout. This is for --cref.
@@ -228,34 +302,73 @@ static void print(StringRef a, StringRef b) {
 //
 // In this case, strlen is defined by libc.so.6 and used by other two
 // files.
+//
+// Symbols are printed in the order they first appear in the input files,
+// and files in command line order. Instead of building an insertion-ordered
+// map serially, we collect (symbol, file) pairs in parallel and sort them.
 void elf::writeCrossReferenceTable() {
   if (!config->cref)
     return;
 
+  struct Ref {
+    Symbol *sym;
+    uint32_t fileIdx;
+    uint32_t pos;
+  };
+
   // Collect symbols and files.
-  MapVector<Symbol *, SetVector<InputFile *>> map;
-  for (InputFile *file : objectFiles) {
-    for (Symbol *sym : file->getSymbols()) {
-      if (isa<SharedSymbol>(sym))
-        map[sym].insert(file);
+  std::vector<std::vector<Ref>> fileRefs(objectFiles.size());
+  parallelForEachN(0, objectFiles.size(), [&](size_t i) {
+    ArrayRef<Symbol *> syms = objectFiles[i]->getSymbols();
+    for (size_t j = 0, e = syms.size(); j < e; ++j) {
+      Symbol *sym = syms[j];
       if (auto *d = dyn_cast<Defined>(sym))
-        if (!d->isLocal() && (!d->section || d->section->isLive()))
-          map[d].insert(file);
+        if (d->isLocal() || (d->section && !d->section->isLive()))
+          continue;
+      if (isa<SharedSymbol>(sym) || isa<Defined>(sym))
+        fileRefs[i].push_back({sym, (uint32_t)i, (uint32_t)j});
     }
+  });
+
+  std::vector<Ref> refs;
+  for (std::vector<Ref> &v : fileRefs) {
+    refs.insert(refs.end(), v.begin(), v.end());
+    v = {};
   }
 
+  // Group references by symbol. Within a group, references are in file
+  // order, so the first one tells where the symbol first appeared.
+  parallelSort(refs, [](const Ref &a, const Ref &b) {
+    return std::tie(a.sym, a.fileIdx, a.pos) <
+           std::tie(b.sym, b.fileIdx, b.pos);
+  });
+
+  std::vector<size_t> groups;
+  for (size_t i = 0, e = refs.size(); i < e; ++i)
+    if (i == 0 || refs[i].sym != refs[i - 1].sym)
+      groups.push_back(i);
+
+  parallelSort(groups, [&](size_t a, size_t b) {
+    return std::tie(refs[a].fileIdx, refs[a].pos) <
+           std::tie(refs[b].fileIdx, refs[b].pos);
+  });
+
   // Print out a header.
   outs() << "Cross Reference Table\n\n";
-  print("Symbol", "File");
+  print(outs(), "Symbol", "File");
 
   // Print out a table.
-  for (auto kv : map) {
-    Symbol *sym = kv.first;
-    SetVector<InputFile *> &files = kv.second;
-
-    print(toString(*sym), toString(sym->file));
-    for (InputFile *file : files)
-      if (file != sym->file)
-        print("", toString(file));
-  }
+  initFileNameCaches();
+  writeChunks(outs(), groups.size(), [&](raw_ostream &os, size_t i) {
+    Symbol *sym = refs[groups[i]].sym;
+    print(os, toString(*sym), toString(sym->file));
+
+    uint32_t prev = -1;
+    for (size_t j = groups[i]; j < refs.size() && refs[j].sym == sym; ++j) {
+      uint32_t idx = refs[j].fileIdx;
+      if (idx != prev && objectFiles[idx] != sym->file)
+        print(os, "", toString(objectFiles[idx]));
+      prev = idx;
+    }
+  });
 }
@@ -29,6 +29,7 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Object/ELF.h"
 #include <functional>
@@ -42,6 +43,8 @@ using namespace llvm::support::endian;
 using namespace lld;
 using namespace lld::elf;
 
+static Timer gcTimer("GC", Timer::root());
+
 namespace {
 template <class ELFT> class MarkLive {
 public:
@@ -281,7 +284,7 @@ template <class ELFT> void MarkLive<ELFT>::mark() {
         resolveReloc(sec, rel, false);
     }
 
-    for (InputSectionBase *isec : sec.dependentSections)
+    for (InputSectionBase *isec : sec.getDependentSections())
       enqueue(isec, 0);
   }
 }
@@ -306,6 +309,8 @@ template <class ELFT> void MarkLive<ELFT>::moveToMain() {
 // input sections. This function make some or all of them on
 // so that they are emitted to the output file.
 template <class ELFT> void elf::markLive() {
+  ScopedTimer t(gcTimer);
+
   // If -gc-sections is not given, no sections are removed.
   if (!config->gcSections) {
     for (InputSectionBase *sec : inputSections)
@@ -216,47 +216,101 @@ static void writeInt(uint8_t *buf, uint64_t data, uint64_t size) {
 }
 
 template <class ELFT> void OutputSection::writeTo(uint8_t *buf) {
-  if (type == SHT_NOBITS)
-    return;
+  writeSections<ELFT>({{this, buf}});
+}
 
-  // If -compress-debug-section is specified and if this is a debug seciton,
-  // we've already compressed section contents. If that's the case,
-  // just write it down.
-  if (!compressedData.empty()) {
-    memcpy(buf, zDebugHeader.data(), zDebugHeader.size());
-    memcpy(buf + zDebugHeader.size(), compressedData.data(),
-           compressedData.size());
-    return;
+// Most programs have a few large output sections and many small ones.
+// Writing output sections one at a time, each with its own parallel loop
+// over its input sections, leaves threads idle while small sections are
+// written. Instead, we flatten the input sections of all output sections
+// into one list of tasks and run a single parallel loop over it.
+template <class ELFT>
+void OutputSection::writeSections(
+    ArrayRef<std::pair<OutputSection *, uint8_t *>> v) {
+  struct Job {
+    OutputSection *os;
+    uint8_t *buf;
+    std::vector<InputSection *> sections;
+    std::array<uint8_t, 4> filler;
+    bool nonZeroFiller;
+  };
+
+  // A task is an index into jobs and an index into the job's input
+  // sections. The index -1 stands for the rest of the output section:
+  // its compressed contents or the padding before the first input section.
+  std::vector<Job> jobs;
+  std::vector<std::pair<uint32_t, uint32_t>> tasks;
+
+  for (const std::pair<OutputSection *, uint8_t *> &p : v) {
+    OutputSection *os = p.first;
+    if (os->type == SHT_NOBITS)
+      continue;
+
+    Job job{os, p.second, {}, {}, false};
+    if (os->compressedData.empty()) {
+      job.sections = getInputSections(os);
+      job.filler = os->getFiller();
+      job.nonZeroFiller = read32(job.filler.data()) != 0;
+    }
+
+    uint32_t jobIdx = jobs.size();
+    tasks.push_back({jobIdx, (uint32_t)-1});
+    for (size_t i = 0, e = job.sections.size(); i < e; ++i)
+      tasks.push_back({jobIdx, i});
+    jobs.push_back(std::move(job));
   }
 
-  // Write leading padding.
-  std::vector<InputSection *> sections = getInputSections(this);
-  std::array<uint8_t, 4> filler = getFiller();
-  bool nonZeroFiller = read32(filler.data()) != 0;
-  if (nonZeroFiller)
-    fill(buf, sections.empty() ? size : sections[0]->outSecOff, filler);
+  parallelForEachN(0, tasks.size(), [&](size_t i) {
+    Job &job = jobs[tasks[i].first];
+    OutputSection *os = job.os;
+    uint8_t *buf = job.buf;
+    uint32_t idx = tasks[i].second;
+
+    if (idx == (uint32_t)-1) {
+      // If -compress-debug-section is specified and if this is a debug
+      // seciton, we've already compressed section contents. If that's the
+      // case, just write it down.
+      if (!os->compressedData.empty()) {
+        memcpy(buf, os->zDebugHeader.data(), os->zDebugHeader.size());
+        memcpy(buf + os->zDebugHeader.size(), os->compressedData.data(),
+               os->compressedData.size());
+        return;
+      }
+
+      // Write leading padding.
+      if (job.nonZeroFiller)
+        fill(buf,
+             job.sections.empty() ? os->size : job.sections[0]->outSecOff,
+             job.filler);
+      return;
+    }
 
-  parallelForEachN(0, sections.size(), [&](size_t i) {
-    InputSection *isec = sections[i];
+    InputSection *isec = job.sections[idx];
     isec->writeTo<ELFT>(buf);
 
     // Fill gaps between sections.
-    if (nonZeroFiller) {
+    if (job.nonZeroFiller) {
       uint8_t *start = buf + isec->outSecOff + isec->getSize();
       uint8_t *end;
-      if (i + 1 == sections.size())
-        end = buf + size;
+      if (idx + 1 == job.sections.size())
+        end = buf + os->size;
       else
-        end = buf + sections[i + 1]->outSecOff;
-      fill(start, end - start, filler);
+        end = buf + job.sections[idx + 1]->outSecOff;
+      fill(start, end - start, job.filler);
     }
   });
 
   // Linker scripts may have BYTE()-family commands with which you
   // can write arbitrary bytes to the output. Process them if any.
-  for (BaseCommand *base : sectionCommands)
-    if (auto *data = dyn_cast<ByteCommand>(base))
-      writeInt(buf + data->offset, data->expression().getValue(), data->size);
+  // They may overlap with fillers, so they are written last.
+  for (Job &job : jobs) {
+    if (!job.os->compressedData.empty())
+      continue;
+    for (BaseCommand *base : job.os->sectionCommands)
+      if (auto *data = dyn_cast<ByteCommand>(base))
+        writeInt(job.buf + data->offset, data->expression().getValue(),
+                 data->size);
+  }
 }
 
 static void finalizeShtGroup(OutputSection *os,
@@ -415,6 +469,15 @@ template void OutputSection::writeTo<ELF32BE>(uint8_t *Buf);
 template void OutputSection::writeTo<ELF64LE>(uint8_t *Buf);
 template void OutputSection::writeTo<ELF64BE>(uint8_t *Buf);
 
+template void OutputSection::writeSections<ELF32LE>(
+    ArrayRef<std::pair<OutputSection *, uint8_t *>>);
+template void OutputSection::writeSections<ELF32BE>(
+    ArrayRef<std::pair<OutputSection *, uint8_t *>>);
+template void OutputSection::writeSections<ELF64LE>(
+    ArrayRef<std::pair<OutputSection *, uint8_t *>>);
+template void OutputSection::writeSections<ELF64BE>(
+    ArrayRef<std::pair<OutputSection *, uint8_t *>>);
+
 template void OutputSection::maybeCompress<ELF32LE>();
 template void OutputSection::maybeCompress<ELF32BE>();
 template void OutputSection::maybeCompress<ELF64LE>();
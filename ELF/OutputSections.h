@@ -102,6 +102,13 @@ public:
   template <class ELFT> void writeTo(uint8_t *buf);
   template <class ELFT> void maybeCompress();
 
+  // Writes the contents of each output section to the corresponding
+  // buffer. All input sections of all given output sections are written
+  // by one parallel loop.
+  template <class ELFT>
+  static void
+  writeSections(ArrayRef<std::pair<OutputSection *, uint8_t *>> sections);
+
   void sort(llvm::function_ref<int(InputSectionBase *s)> order);
   void sortInitFini();
   void sortCtorsDtors();
@@ -506,10 +506,7 @@ static void replaceWithDefined(Symbol &sym, SectionBase *sec, uint64_t value,
   sym.replace(Defined{sym.file, sym.getName(), sym.binding, sym.stOther,
                       sym.type, value, size, sec});
 
-  sym.pltIndex = old.pltIndex;
-  sym.gotIndex = old.gotIndex;
   sym.verdefIndex = old.verdefIndex;
-  sym.ppc64BranchltIndex = old.ppc64BranchltIndex;
   sym.isPreemptible = true;
   sym.exportDynamic = true;
   sym.isUsedInRegularObj = true;
@@ -1083,7 +1080,7 @@ static void processRelocAux(InputSectionBase &sec, RelExpr expr, RelType type,
     if (!sym.isDefined())
       replaceWithDefined(
           sym, in.plt,
-          target->pltHeaderSize + target->pltEntrySize * sym.pltIndex, 0);
+          target->pltHeaderSize + target->pltEntrySize * sym.getPltIdx(), 0);
     sym.needsPltAddr = true;
     sec.relocations.push_back({expr, type, offset, addend, &sym});
     return;
@@ -1287,9 +1284,10 @@ static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
       // that's really needed to create the IRELATIVE is the section and value,
       // so ideally we should just need to copy those.
       auto *directSym = make<Defined>(cast<Defined>(sym));
+      directSym->auxIdx = -1;
       addPltEntry<ELFT>(in.iplt, in.igotPlt, in.relaIplt, target->iRelativeRel,
                         *directSym);
-      sym.pltIndex = directSym->pltIndex;
+      sym.setPltIdx(directSym->getPltIdx());
     }
     if (expr == R_ABS && addend == 0 && (sec.flags & SHF_WRITE)) {
       // We might be able to represent this as an IRELATIVE. But we don't know
@@ -1312,7 +1310,7 @@ static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
     } else if (!needsPlt(expr)) {
       // Make the ifunc's PLT entry canonical by changing the value of its
       // symbol to redirect all references to point to it.
-      unsigned entryOffset = sym.pltIndex * target->pltEntrySize;
+      unsigned entryOffset = sym.getPltIdx() * target->pltEntrySize;
       if (config->zRetpolineplt)
         entryOffset += target->pltHeaderSize;
 
@@ -26,6 +26,8 @@ using namespace llvm::ELF;
 using namespace lld;
 using namespace lld::elf;
 
+std::vector<SymbolAux> elf::symAux;
+
 Defined *ElfSym::bss;
 Defined *ElfSym::etext1;
 Defined *ElfSym::etext2;
@@ -151,7 +153,9 @@ uint64_t Symbol::getGotVA() const {
   return in.got->getVA() + getGotOffset();
 }
 
-uint64_t Symbol::getGotOffset() const { return gotIndex * config->wordsize; }
+uint64_t Symbol::getGotOffset() const {
+  return getGotIdx() * config->wordsize;
+}
 
 uint64_t Symbol::getGotPltVA() const {
   if (isInIplt)
@@ -161,19 +165,19 @@ uint64_t Symbol::getGotPltVA() const {
 
 uint64_t Symbol::getGotPltOffset() const {
   if (isInIplt)
-    return pltIndex * config->wordsize;
-  return (pltIndex + target->gotPltHeaderEntriesNum) * config->wordsize;
+    return getPltIdx() * config->wordsize;
+  return (getPltIdx() + target->gotPltHeaderEntriesNum) * config->wordsize;
 }
 
 uint64_t Symbol::getPPC64LongBranchOffset() const {
-  assert(ppc64BranchltIndex != 0xffff);
-  return ppc64BranchltIndex * config->wordsize;
+  assert(isInPPC64Branchlt());
+  return getPPC64BranchltIdx() * config->wordsize;
 }
 
 uint64_t Symbol::getPltVA() const {
   PltSection *plt = isInIplt ? in.iplt : in.plt;
   uint64_t outVA =
-      plt->getVA() + plt->headerSize + pltIndex * target->pltEntrySize;
+      plt->getVA() + plt->headerSize + getPltIdx() * target->pltEntrySize;
   // While linking microMIPS code PLT code are always microMIPS
   // code. Set the less-significant bit to track that fact.
   // See detailed comment in the `getSymVA` function.
@@ -183,9 +187,9 @@ uint64_t Symbol::getPltVA() const {
 }
 
 uint64_t Symbol::getPPC64LongBranchTableVA() const {
-  assert(ppc64BranchltIndex != 0xffff);
+  assert(isInPPC64Branchlt());
   return in.ppc64LongBranchTarget->getVA() +
-         ppc64BranchltIndex * config->wordsize;
+         getPPC64BranchltIdx() * config->wordsize;
 }
 
 uint64_t Symbol::getSize() const {
@@ -55,6 +55,20 @@ struct StringRefZ {
   const uint32_t size;
 };
 
+// Most symbols never get a GOT or PLT entry, so the indices of such entries
+// are kept out of line to make Symbol smaller. A symbol that needs any of
+// them is assigned a SymbolAux entry on demand.
+struct SymbolAux {
+  uint32_t gotIdx = -1;
+  uint32_t pltIdx = -1;
+  uint32_t globalDynIdx = -1;
+
+  // An index into the .branch_lt section on PPC64.
+  uint16_t ppc64BranchltIdx = -1;
+};
+
+extern std::vector<SymbolAux> symAux;
+
 // The base class for real symbol classes.
 class Symbol {
 public:
@@ -79,20 +93,17 @@ protected:
 
 public:
   uint32_t dynsymIndex = 0;
-  uint32_t gotIndex = -1;
-  uint32_t pltIndex = -1;
-
-  uint32_t globalDynIndex = -1;
 
   // This field is a index to the symbol's version definition.
   uint32_t verdefIndex = -1;
 
+  // An index into symAux, or -1 if this symbol has no GOT, PLT or other
+  // auxiliary entries. See SymbolAux.
+  uint32_t auxIdx = -1;
+
   // Version definition index.
   uint16_t versionId;
 
-  // An index into the .branch_lt section on PPC64.
-  uint16_t ppc64BranchltIndex = -1;
-
   // Symbol binding. This is not overwritten by replace() to track
   // changes during resolution. In particular:
   //  - An undefined weak is still weak when it resolves to a shared library.
@@ -168,9 +179,27 @@ public:
 
   void parseSymbolVersion();
 
-  bool isInGot() const { return gotIndex != -1U; }
-  bool isInPlt() const { return pltIndex != -1U; }
-  bool isInPPC64Branchlt() const { return ppc64BranchltIndex != 0xffff; }
+  uint32_t getGotIdx() const {
+    return auxIdx == -1U ? -1U : symAux[auxIdx].gotIdx;
+  }
+  uint32_t getPltIdx() const {
+    return auxIdx == -1U ? -1U : symAux[auxIdx].pltIdx;
+  }
+  uint32_t getGlobalDynIdx() const {
+    return auxIdx == -1U ? -1U : symAux[auxIdx].globalDynIdx;
+  }
+  uint16_t getPPC64BranchltIdx() const {
+    return auxIdx == -1U ? 0xffff : symAux[auxIdx].ppc64BranchltIdx;
+  }
+
+  void setGotIdx(uint32_t idx) { getAux().gotIdx = idx; }
+  void setPltIdx(uint32_t idx) { getAux().pltIdx = idx; }
+  void setGlobalDynIdx(uint32_t idx) { getAux().globalDynIdx = idx; }
+  void setPPC64BranchltIdx(uint16_t idx) { getAux().ppc64BranchltIdx = idx; }
+
+  bool isInGot() const { return getGotIdx() != -1U; }
+  bool isInPlt() const { return getPltIdx() != -1U; }
+  bool isInPPC64Branchlt() const { return getPPC64BranchltIdx() != 0xffff; }
 
   uint64_t getVA(int64_t addend = 0) const;
 
@@ -221,6 +250,7 @@ private:
   int compare(const Symbol *other) const;
 
   inline size_t getSymbolSize() const;
+  inline SymbolAux &getAux();
 
 protected:
   Symbol(Kind k, InputFile *file, StringRefZ name, uint8_t binding,
@@ -465,9 +495,9 @@ union SymbolUnion {
 };
 
 // It is important to keep the size of SymbolUnion small for performance and
-// memory usage reasons. 80 bytes is a soft limit based on the size of Defined
+// memory usage reasons. 72 bytes is a soft limit based on the size of Defined
 // on a 64-bit system.
-static_assert(sizeof(SymbolUnion) <= 80, "SymbolUnion too large");
+static_assert(sizeof(SymbolUnion) <= 72, "SymbolUnion too large");
 
 template <typename T> struct AssertSymbol {
   static_assert(std::is_trivially_destructible<T>(),
@@ -508,6 +538,14 @@ size_t Symbol::getSymbolSize() const {
   llvm_unreachable("unknown symbol kind");
 }
 
+SymbolAux &Symbol::getAux() {
+  if (auxIdx == -1U) {
+    auxIdx = symAux.size();
+    symAux.emplace_back();
+  }
+  return symAux[auxIdx];
+}
+
 // replace() replaces "this" object with a given symbol by memcpy'ing
 // it over to "this". This function is called as a result of name
 // resolution, e.g. to replace an undefind symbol with a defined symbol.
@@ -531,6 +569,7 @@ void Symbol::replace(const Symbol &New) {
   memcpy(this, &New, New.getSymbolSize());
 
   versionId = old.versionId;
+  auxIdx = old.auxIdx;
   visibility = old.visibility;
   isUsedInRegularObj = old.isUsedInRegularObj;
   exportDynamic = old.exportDynamic;
@@ -435,8 +435,12 @@ template <class ELFT> void EhFrameSection::addSection(InputSectionBase *c) {
   alignment = std::max(alignment, sec->alignment);
   sections.push_back(sec);
 
-  for (auto *ds : sec->dependentSections)
-    dependentSections.push_back(ds);
+  // Copy the list first because adding to it may reallocate the map that
+  // sec's dependent sections live in.
+  SmallVector<InputSection *, 4> deps(sec->getDependentSections().begin(),
+                                      sec->getDependentSections().end());
+  for (InputSection *ds : deps)
+    addDependentSection(ds);
 
   if (sec->pieces.empty())
     return;
@@ -587,14 +591,14 @@ GotSection::GotSection()
 }
 
 void GotSection::addEntry(Symbol &sym) {
-  sym.gotIndex = numEntries;
+  sym.setGotIdx(numEntries);
   ++numEntries;
 }
 
 bool GotSection::addDynTlsEntry(Symbol &sym) {
-  if (sym.globalDynIndex != -1U)
+  if (sym.getGlobalDynIdx() != -1U)
     return false;
-  sym.globalDynIndex = numEntries;
+  sym.setGlobalDynIdx(numEntries);
   // Global Dynamic TLS entries take two GOT slots.
   numEntries += 2;
   return true;
@@ -611,11 +615,11 @@ bool GotSection::addTlsIndex() {
 }
 
 uint64_t GotSection::getGlobalDynAddr(const Symbol &b) const {
-  return this->getVA() + b.globalDynIndex * config->wordsize;
+  return this->getVA() + b.getGlobalDynIdx() * config->wordsize;
 }
 
 uint64_t GotSection::getGlobalDynOffset(const Symbol &b) const {
-  return b.globalDynIndex * config->wordsize;
+  return b.getGlobalDynIdx() * config->wordsize;
 }
 
 void GotSection::finalizeContents() {
@@ -908,12 +912,12 @@ void MipsGotSection::build() {
     }
   }
 
-  // Update Symbol::gotIndex field to use this
+  // Update the GOT index of each symbol to use this
   // value later in the `sortMipsSymbols` function.
   for (auto &p : primGot->global)
-    p.first->gotIndex = p.second;
+    p.first->setGotIdx(p.second);
   for (auto &p : primGot->relocs)
-    p.first->gotIndex = p.second;
+    p.first->setGotIdx(p.second);
 
   // Create dynamic relocations.
   for (FileGot &got : gots) {
@@ -1072,7 +1076,7 @@ GotPltSection::GotPltSection()
 }
 
 void GotPltSection::addEntry(Symbol &sym) {
-  assert(sym.pltIndex == entries.size());
+  assert(sym.getPltIdx() == entries.size());
   entries.push_back(&sym);
 }
 
@@ -1116,7 +1120,7 @@ IgotPltSection::IgotPltSection()
                        config->wordsize, getIgotPltName()) {}
 
 void IgotPltSection::addEntry(Symbol &sym) {
-  assert(sym.pltIndex == entries.size());
+  assert(sym.getPltIdx() == entries.size());
   entries.push_back(&sym);
 }
 
@@ -1872,7 +1876,7 @@ static bool sortMipsSymbols(const SymbolTableEntry &l,
   // Sort entries related to non-local preemptible symbols by GOT indexes.
   // All other entries go to the beginning of a dynsym in arbitrary order.
   if (l.sym->isInGot() && r.sym->isInGot())
-    return l.sym->gotIndex < r.sym->gotIndex;
+    return l.sym->getGotIdx() < r.sym->getGotIdx();
   if (!l.sym->isInGot() && !r.sym->isInGot())
     return false;
   return !l.sym->isInGot();
@@ -2371,13 +2375,13 @@ void PltSection::writeTo(uint8_t *buf) {
     unsigned relOff = relSec->entsize * i + pltOff;
     uint64_t got = b->getGotPltVA();
     uint64_t plt = this->getVA() + off;
-    target->writePlt(buf + off, got, plt, b->pltIndex, relOff);
+    target->writePlt(buf + off, got, plt, b->getPltIdx(), relOff);
     off += target->pltEntrySize;
   }
 }
 
 template <class ELFT> void PltSection::addEntry(Symbol &sym) {
-  sym.pltIndex = entries.size();
+  sym.setPltIdx(entries.size());
   entries.push_back(&sym);
 }
 
@@ -3096,7 +3100,7 @@ ARMExidxSyntheticSection::ARMExidxSyntheticSection()
                        config->wordsize, ".ARM.exidx") {}
 
 static InputSection *findExidxSection(InputSection *isec) {
-  for (InputSection *d : isec->dependentSections)
+  for (InputSection *d : isec->getDependentSections())
     if (d->type == SHT_ARM_EXIDX)
       return d;
   return nullptr;
@@ -3365,8 +3369,8 @@ PPC64LongBranchTargetSection::PPC64LongBranchTargetSection()
                        ".branch_lt") {}
 
 void PPC64LongBranchTargetSection::addEntry(Symbol &sym) {
-  assert(sym.ppc64BranchltIndex == 0xffff);
-  sym.ppc64BranchltIndex = entries.size();
+  assert(!sym.isInPPC64Branchlt());
+  sym.setPPC64BranchltIdx(entries.size());
   entries.push_back(&sym);
 }
 
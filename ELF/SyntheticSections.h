@@ -980,7 +980,7 @@ public:
 //
 // Instead of storing pointers to the .ARM.exidx InputSections from
 // InputObjects, we store pointers to the executable sections that need
-// .ARM.exidx sections. We can then use the dependentSections of these to
+// .ARM.exidx sections. We can then use the dependent sections of these to
 // either find the .ARM.exidx section or know that we need to generate one.
 class ARMExidxSyntheticSection : public SyntheticSection {
 public:
@@ -1011,7 +1011,7 @@ private:
 
   // Instead of storing pointers to the .ARM.exidx InputSections from
   // InputObjects, we store pointers to the executable sections that need
-  // .ARM.exidx sections. We can then use the dependentSections of these to
+  // .ARM.exidx sections. We can then use the dependent sections of these to
   // either find the .ARM.exidx section or know that we need to generate one.
   std::vector<InputSection *> executableSections;
 
@@ -22,8 +22,10 @@
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/RandomNumberGenerator.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/xxhash.h"
@@ -38,6 +40,15 @@ using namespace llvm::support::endian;
 using namespace lld;
 using namespace lld::elf;
 
+static Timer codeLayoutTimer("Code Layout", Timer::root());
+static Timer scanRelocationsTimer("Scan Relocations", codeLayoutTimer);
+static Timer thunkTimer("Thunk Passes", codeLayoutTimer);
+static Timer writeSectionsTimer("Write Sections", Timer::root());
+static Timer buildIdTimer("Build ID", Timer::root());
+static Timer mapFileTimer("Map File", Timer::root());
+static Timer partitionFilesTimer("Partition Files", Timer::root());
+static Timer diskCommitTimer("Commit Output File", Timer::root());
+
 namespace {
 // The writer writes a SymbolTable result to a file.
 template <class ELFT> class Writer {
@@ -76,6 +87,7 @@ private:
   void writeSections();
   void writeSectionsBinary();
   void writeBuildId();
+  void writePartitionFiles();
 
   std::unique_ptr<FileOutputBuffer> &buffer;
 
@@ -544,6 +556,8 @@ template <class ELFT> static void createSyntheticSections() {
 
 // The main function of the writer.
 template <class ELFT> void Writer<ELFT>::run() {
+  ScopedTimer t1(codeLayoutTimer);
+
   // Make copies of any input sections that need to be copied into each
   // partition.
   copySectionsIntoPartitions<ELFT>();
@@ -613,6 +627,8 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (config->checkSections)
     checkSections();
 
+  t1.stop();
+
   // It does not make sense try to open the file if we have error already.
   if (errorCount())
     return;
@@ -621,12 +637,15 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (errorCount())
     return;
 
-  if (!config->oFormatBinary) {
-    writeTrapInstr();
-    writeHeader();
-    writeSections();
-  } else {
-    writeSectionsBinary();
+  {
+    ScopedTimer t2(writeSectionsTimer);
+    if (!config->oFormatBinary) {
+      writeTrapInstr();
+      writeHeader();
+      writeSections();
+    } else {
+      writeSectionsBinary();
+    }
   }
 
   // Backfill .note.gnu.build-id section content. This is done at last
@@ -636,11 +655,19 @@ template <class ELFT> void Writer<ELFT>::run() {
     return;
 
   // Handle -Map and -cref options.
-  writeMapFile();
-  writeCrossReferenceTable();
+  {
+    ScopedTimer t3(mapFileTimer);
+    writeMapFile();
+    writeCrossReferenceTable();
+  }
   if (errorCount())
     return;
 
+  writePartitionFiles();
+  if (errorCount())
+    return;
+
+  ScopedTimer t4(diskCommitTimer);
   if (auto e = buffer->commit())
     error("failed to write to the output file: " + toString(std::move(e)));
 }
@@ -1220,6 +1247,27 @@ findOrphanPos(std::vector<BaseCommand *>::iterator b,
   return i;
 }
 
+// Returns a symbol name without compiler-generated suffixes, so that a
+// symbol ordering file stays usable when these suffixes change from build
+// to build. ThinLTO appends ".llvm.<hash>" to promoted local symbols, GCC
+// LTO appends ".lto_priv.<N>", and compilers append ".<N>" to the names of
+// function-local statics.
+static StringRef getCanonicalOrderName(StringRef name) {
+  for (StringRef suffix : {".llvm.", ".lto_priv."}) {
+    size_t pos = name.find(suffix);
+    if (pos != StringRef::npos && pos != 0)
+      name = name.substr(0, pos);
+  }
+
+  for (;;) {
+    size_t pos = name.rfind('.');
+    if (pos == StringRef::npos || pos == 0 || pos + 1 == name.size() ||
+        name.find_first_not_of("0123456789", pos + 1) != StringRef::npos)
+      return name;
+    name = name.substr(0, pos);
+  }
+}
+
 // Builds section order for handling --symbol-ordering-file.
 static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
   DenseMap<const InputSectionBase *, int> sectionOrder;
@@ -1230,26 +1278,47 @@ static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
   if (config->symbolOrderingFile.empty())
     return sectionOrder;
 
+  enum MatchKind { NotFound, Fuzzy, Exact };
+
   struct SymbolOrderEntry {
     int priority;
-    bool present;
+    MatchKind match;
   };
 
   // Build a map from symbols to their priorities. Symbols that didn't
   // appear in the symbol ordering file have the lowest priority 0.
   // All explicitly mentioned symbols have negative (higher) priorities.
-  DenseMap<StringRef, SymbolOrderEntry> symbolOrder;
+  std::vector<SymbolOrderEntry> entries;
+  DenseMap<StringRef, size_t> symbolOrder;
   int priority = -config->symbolOrderingFile.size();
-  for (StringRef s : config->symbolOrderingFile)
-    symbolOrder.insert({s, {priority++, false}});
+  for (StringRef s : config->symbolOrderingFile) {
+    symbolOrder.insert({s, entries.size()});
+    entries.push_back({priority++, NotFound});
+  }
+
+  // With --symbol-ordering-fuzzy, a symbol that is not in the ordering file
+  // by its exact name gets the priority of the first entry with the same
+  // canonical name.
+  DenseMap<StringRef, size_t> fuzzyOrder;
+  if (config->symbolOrderingFuzzy)
+    for (size_t i = 0, e = entries.size(); i < e; ++i)
+      fuzzyOrder.insert(
+          {getCanonicalOrderName(config->symbolOrderingFile[i]), i});
 
   // Build a map from sections to their priorities.
   auto addSym = [&](Symbol &sym) {
+    MatchKind match = Exact;
     auto it = symbolOrder.find(sym.getName());
-    if (it == symbolOrder.end())
-      return;
-    SymbolOrderEntry &ent = it->second;
-    ent.present = true;
+    if (it == symbolOrder.end()) {
+      if (fuzzyOrder.empty())
+        return;
+      it = fuzzyOrder.find(getCanonicalOrderName(sym.getName()));
+      if (it == fuzzyOrder.end())
+        return;
+      match = Fuzzy;
+    }
+    SymbolOrderEntry &ent = entries[it->second];
+    ent.match = std::max(ent.match, match);
 
     maybeWarnUnorderableSymbol(&sym);
 
@@ -1274,9 +1343,39 @@ static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
         addSym(*sym);
 
   if (config->warnSymbolOrdering)
-    for (auto orderEntry : symbolOrder)
-      if (!orderEntry.second.present)
-        warn("symbol ordering file: no such symbol: " + orderEntry.first);
+    for (size_t i = 0, e = entries.size(); i < e; ++i)
+      if (entries[i].match == NotFound)
+        warn("symbol ordering file: no such symbol: " +
+             config->symbolOrderingFile[i]);
+
+  if (config->printSymbolOrderingStats) {
+    size_t numExact = 0;
+    size_t numFuzzy = 0;
+    for (SymbolOrderEntry &ent : entries) {
+      if (ent.match == Exact)
+        ++numExact;
+      else if (ent.match == Fuzzy)
+        ++numFuzzy;
+    }
+
+    uint64_t codeSize = 0;
+    uint64_t dataSize = 0;
+    for (auto &p : sectionOrder) {
+      if (p.first->flags & SHF_EXECINSTR)
+        codeSize += p.first->getSize();
+      else
+        dataSize += p.first->getSize();
+    }
+
+    message("symbol ordering file: " + Twine(entries.size()) + " symbols, " +
+            Twine(numExact) + " found, " + Twine(numFuzzy) +
+            " found by canonical name, " +
+            Twine(entries.size() - numExact - numFuzzy) + " not found");
+    message("symbol ordering file: " + Twine(sectionOrder.size()) +
+            " sections ordered, " + Twine(codeSize + dataSize) + " bytes (" +
+            Twine(codeSize) + " bytes of code, " + Twine(dataSize) +
+            " bytes of data)");
+  }
 
   return sectionOrder;
 }
@@ -1567,6 +1666,8 @@ template <class ELFT> void Writer<ELFT>::resolveShfLinkOrder() {
 // addresses we must converge to a fixed point. We do that here. See the comment
 // in Writer<ELFT>::finalizeSections().
 template <class ELFT> void Writer<ELFT>::finalizeAddressDependentContent() {
+  ScopedTimer t(thunkTimer);
+
   ThunkCreator tc;
   AArch64Err843419Patcher a64p;
 
@@ -1738,6 +1839,7 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   // Scan relocations. This must be done after every symbol is declared so that
   // we can correctly decide if a dynamic relocation is needed.
   if (!config->relocatable) {
+    ScopedTimer t(scanRelocationsTimer);
     forEachRelSec(scanRelocations<ELFT>);
     reportUndefinedSymbols<ELFT>();
   }
@@ -2553,9 +2655,11 @@ template <class ELFT> void Writer<ELFT>::openFile() {
 }
 
 template <class ELFT> void Writer<ELFT>::writeSectionsBinary() {
+  std::vector<std::pair<OutputSection *, uint8_t *>> v;
   for (OutputSection *sec : outputSections)
     if (sec->flags & SHF_ALLOC)
-      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+      v.push_back({sec, Out::bufferStart + sec->offset});
+  OutputSection::writeSections<ELFT>(v);
 }
 
 static void fillTrap(uint8_t *i, uint8_t *end) {
@@ -2600,14 +2704,124 @@ template <class ELFT> void Writer<ELFT>::writeTrapInstr() {
 template <class ELFT> void Writer<ELFT>::writeSections() {
   // In -r or -emit-relocs mode, write the relocation sections first as in
   // ELf_Rel targets we might find out that we need to modify the relocated
-  // section while doing it.
-  for (OutputSection *sec : outputSections)
+  // section while doing it. Each of the two groups is written by one
+  // parallel loop over all of its input sections.
+  std::vector<std::pair<OutputSection *, uint8_t *>> rels;
+  std::vector<std::pair<OutputSection *, uint8_t *>> others;
+  for (OutputSection *sec : outputSections) {
     if (sec->type == SHT_REL || sec->type == SHT_RELA)
-      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+      rels.push_back({sec, Out::bufferStart + sec->offset});
+    else
+      others.push_back({sec, Out::bufferStart + sec->offset});
+  }
+  OutputSection::writeSections<ELFT>(rels);
+  OutputSection::writeSections<ELFT>(others);
+}
 
-  for (OutputSection *sec : outputSections)
-    if (sec->type != SHT_REL && sec->type != SHT_RELA)
-      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+// Writes each loadable partition to its own file in --partition-dir. A
+// partition occupies a contiguous range of the output file starting at its
+// ELF header, so the file is a copy of that range followed by a copy of
+// .shstrtab and headers for the partition's output sections. The result is
+// the same as what llvm-objcopy --extract-partition would produce, but we
+// don't need to read the combined output again.
+template <class ELFT> void Writer<ELFT>::writePartitionFiles() {
+  if (config->partitionDir.empty() || config->oFormatBinary ||
+      partitions.size() == 1)
+    return;
+  ScopedTimer t(partitionFilesTimer);
+
+  if (std::error_code ec = sys::fs::create_directories(config->partitionDir)) {
+    error("cannot create directory " + config->partitionDir + ": " +
+          ec.message());
+    return;
+  }
+
+  OutputSection *strTab = in.shStrTab->getParent();
+
+  for (Partition &part : partitions) {
+    if (&part == mainPart)
+      continue;
+
+    // Program header offsets of a loadable partition are already relative
+    // to its ELF header.
+    uint64_t start = part.elfHeader->getParent()->offset;
+    uint64_t size = 0;
+    for (PhdrEntry *p : part.phdrs)
+      size = std::max<uint64_t>(size, p->p_offset + p->p_filesz);
+
+    // Assign new section indices. Index 0 is the null section and the
+    // last index is .shstrtab.
+    std::vector<OutputSection *> sections;
+    DenseMap<uint32_t, uint32_t> newIndex;
+    for (OutputSection *sec : outputSections) {
+      if (sec->partition != part.getNumber() ||
+          sec->type == SHT_LLVM_PART_EHDR || sec->type == SHT_LLVM_PART_PHDR)
+        continue;
+      sections.push_back(sec);
+      newIndex[sec->sectionIndex] = sections.size();
+    }
+
+    uint64_t shOff = alignTo(size + strTab->size, config->wordsize);
+    size_t shNum = sections.size() + 2;
+    uint64_t partFileSize = shOff + shNum * sizeof(Elf_Shdr);
+
+    SmallString<128> pathBuf(config->partitionDir);
+    sys::path::append(pathBuf, part.name);
+    StringRef path = pathBuf;
+    Expected<std::unique_ptr<FileOutputBuffer>> bufferOrErr =
+        FileOutputBuffer::create(path, partFileSize,
+                                 FileOutputBuffer::F_executable);
+    if (!bufferOrErr) {
+      error("failed to open " + path + ": " +
+            llvm::toString(bufferOrErr.takeError()));
+      continue;
+    }
+    std::unique_ptr<FileOutputBuffer> partBuffer = std::move(*bufferOrErr);
+    uint8_t *buf = partBuffer->getBufferStart();
+
+    // Partitions can be hundreds of megabytes, so copy them in parallel.
+    const size_t chunkSize = 1 << 20;
+    uint8_t *src = Out::bufferStart + start;
+    parallelForEachN(0, divideCeil(size, chunkSize), [&](size_t i) {
+      uint64_t off = i * chunkSize;
+      memcpy(buf + off, src + off, std::min<uint64_t>(chunkSize, size - off));
+    });
+
+    // Section names are offsets into the combined .shstrtab, so we copy
+    // it as a whole.
+    memcpy(buf + size, Out::bufferStart + strTab->offset, strTab->size);
+    memset(buf + size + strTab->size, 0, shOff - size - strTab->size);
+
+    auto *sHdrs = reinterpret_cast<Elf_Shdr *>(buf + shOff);
+    memset(sHdrs, 0, sizeof(Elf_Shdr));
+    for (size_t i = 0, e = sections.size(); i < e; ++i) {
+      Elf_Shdr *shdr = &sHdrs[i + 1];
+      sections[i]->writeHeaderTo<ELFT>(shdr);
+      shdr->sh_offset = shdr->sh_offset - start;
+      shdr->sh_link = newIndex.lookup(shdr->sh_link);
+      if (shdr->sh_flags & SHF_INFO_LINK)
+        shdr->sh_info = newIndex.lookup(shdr->sh_info);
+    }
+    Elf_Shdr *strTabHdr = &sHdrs[shNum - 1];
+    strTab->writeHeaderTo<ELFT>(strTabHdr);
+    strTabHdr->sh_offset = size;
+
+    auto *eHdr = reinterpret_cast<Elf_Ehdr *>(buf);
+    eHdr->e_shoff = shOff;
+    if (shNum >= SHN_LORESERVE)
+      sHdrs->sh_size = shNum;
+    else
+      eHdr->e_shnum = shNum;
+    if (shNum - 1 >= SHN_LORESERVE) {
+      sHdrs->sh_link = shNum - 1;
+      eHdr->e_shstrndx = SHN_XINDEX;
+    } else {
+      eHdr->e_shstrndx = shNum - 1;
+    }
+
+    if (auto e = partBuffer->commit())
+      error("failed to write to " + path + ": " + toString(std::move(e)));
+  }
 }
 
 // Split one uint8 array into small pieces of uint8 arrays.
@@ -2647,6 +2861,8 @@ template <class ELFT> void Writer<ELFT>::writeBuildId() {
   if (!mainPart->buildId || !mainPart->buildId->getParent())
     return;
 
+  ScopedTimer t(buildIdTimer);
+
   if (config->buildId == BuildIdKind::Hexstring) {
     for (Partition &part : partitions)
       part.buildId->writeBuildId(config->buildIdVector);
@@ -23,8 +23,13 @@
 
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/StringSaver.h"
+#include "llvm/Support/TypeName.h"
 #include <vector>
 
+namespace llvm {
+class raw_ostream;
+}
+
 namespace lld {
 
 // Use this arena if your object doesn't have a destructor.
@@ -39,11 +44,23 @@ struct SpecificAllocBase {
   SpecificAllocBase() { instances.push_back(this); }
   virtual ~SpecificAllocBase() = default;
   virtual void reset() = 0;
+  virtual llvm::StringRef getTypeName() const = 0;
+  virtual size_t getObjectSize() const = 0;
   static std::vector<SpecificAllocBase *> instances;
+
+  // The number of objects allocated since the last reset().
+  size_t numObjects = 0;
 };
 
 template <class T> struct SpecificAlloc : public SpecificAllocBase {
-  void reset() override { alloc.DestroyAll(); }
+  void reset() override {
+    alloc.DestroyAll();
+    numObjects = 0;
+  }
+  llvm::StringRef getTypeName() const override {
+    return llvm::getTypeName<T>();
+  }
+  size_t getObjectSize() const override { return sizeof(T); }
   llvm::SpecificBumpPtrAllocator<T> alloc;
 };
 
@@ -51,9 +68,18 @@ template <class T> struct SpecificAlloc : public SpecificAllocBase {
 // Your destructor will be invoked from freeArena().
 template <typename T, typename... U> T *make(U &&... args) {
   static SpecificAlloc<T> alloc;
+  ++alloc.numObjects;
   return new (alloc.alloc.Allocate()) T(std::forward<U>(args)...);
 }
 
+// Prints the number of objects of each type allocated with make<T>(), the
+// size of the bump allocator and the peak resident set size of the process.
+void printArenaUsage(llvm::raw_ostream &os);
+
+// Returns the peak resident set size of this process in bytes, or 0 if
+// it is not available on this platform.
+uint64_t getPeakRSS();
+
 } // namespace lld
 
 #endif
@@ -36,8 +36,12 @@ public:
 
   bool match(llvm::StringRef s) const;
 
+  // Returns the source strings of the glob patterns.
+  llvm::ArrayRef<std::string> getPatterns() const { return strings; }
+
 private:
   std::vector<llvm::GlobPattern> patterns;
+  std::vector<std::string> strings;
 };
 
 } // namespace lld
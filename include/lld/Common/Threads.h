@@ -58,6 +58,8 @@
 #ifndef LLD_COMMON_THREADS_H
 #define LLD_COMMON_THREADS_H
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Parallel.h"
 #include <functional>
 
@@ -65,23 +67,42 @@ namespace lld {
 
 extern bool threadsEnabled;
 
-template <typename R, class FuncTy> void parallelForEach(R &&range, FuncTy fn) {
-  if (threadsEnabled)
-    for_each(llvm::parallel::par, std::begin(range), std::end(range), fn);
-  else
-    for_each(llvm::parallel::seq, std::begin(range), std::end(range), fn);
-}
+// The maximum number of threads a parallel loop may use, set by
+// --threads=N. Zero means the number of available hardware threads.
+extern unsigned threadCount;
 
-inline void parallelForEachN(size_t begin, size_t end,
-                             llvm::function_ref<void(size_t)> fn) {
-  if (threadsEnabled)
-    for_each_n(llvm::parallel::par, begin, end, fn);
-  else
-    for_each_n(llvm::parallel::seq, begin, end, fn);
+// Returns the number of threads the next parallel loop may use. That is the
+// limit set for the innermost running timer (or its closest ancestor that
+// has one) by --phase-threads, or threadCount otherwise.
+unsigned getThreadLimit();
+
+// Restricts the linker's threads to the CPUs in `cpus`, a comma-separated
+// list of CPU numbers and ranges such as "0-15,32-47". This must be called
+// before the first parallel loop because worker threads inherit the
+// affinity of the thread that creates them.
+void setThreadAffinity(llvm::StringRef cpus);
+
+// Handles --phase-threads=<phase>:<N>, which limits parallel loops run
+// under the timer for <phase> to N threads.
+void setPhaseThreads(llvm::StringRef spec);
+
+// Runs fn(i) for each i in [begin, end) on up to getThreadLimit() threads.
+// The time each thread spends in the loop is accounted to the innermost
+// running timer so that --time can report achieved parallelism and
+// --time-trace can show per-thread spans.
+void parallelForEachN(size_t begin, size_t end,
+                      llvm::function_ref<void(size_t)> fn);
+
+template <typename R, class FuncTy> void parallelForEach(R &&range, FuncTy fn) {
+  auto begin = std::begin(range);
+  parallelForEachN(0, std::distance(begin, std::end(range)),
+                   [&](size_t i) { fn(begin[i]); });
 }
 
+// LLVM's parallel sort cannot be limited to a number of threads, so a sort
+// is either fully parallel or sequential.
 template <typename R, class FuncTy> void parallelSort(R &&range, FuncTy fn) {
-  if (threadsEnabled)
+  if (threadsEnabled && getThreadLimit() != 1)
     sort(llvm::parallel::par, std::begin(range), std::end(range), fn);
   else
     sort(llvm::parallel::seq, std::begin(range), std::end(range), fn);
@@ -12,9 +12,15 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringRef.h"
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <map>
 #include <memory>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
 
 namespace lld {
 
@@ -28,31 +34,75 @@ struct ScopedTimer {
   void stop();
 
   Timer *t = nullptr;
+  Timer *prev = nullptr;
 };
 
 class Timer {
 public:
+  using Clock = std::chrono::high_resolution_clock;
+
   Timer(llvm::StringRef name, Timer &parent);
 
   static Timer &root();
 
+  // Returns the innermost timer started by a ScopedTimer. Parallel loops
+  // attribute their per-thread spans to this timer.
+  static Timer *current();
+
+  // Returns the timers whose name, lowercased and with spaces replaced by
+  // dashes (e.g. "scan-relocations"), is `phase`.
+  static std::vector<Timer *> find(llvm::StringRef phase);
+
   void start();
   void stop();
   void print();
 
+  // Accounts for one thread that worked on a parallel loop run under this
+  // timer from `begin` to `end`.
+  void addParallelWork(Clock::time_point begin, Clock::time_point end);
+
+  // Accounts for the wall-clock time of a parallel loop run under this timer.
+  void addParallelLoop(Clock::duration d);
+
   double millis() const;
+  llvm::StringRef getName() const { return name; }
+  Timer *getParent() const { return parent; }
+
+  // The maximum number of threads parallel loops may use while this timer
+  // is the innermost running one. Zero means inherit from the parent.
+  unsigned threadLimit = 0;
 
 private:
+  friend struct ScopedTimer;
+
   explicit Timer(llvm::StringRef name);
   void print(int depth, double totalDuration, bool recurse = true) const;
 
-  std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
+  std::chrono::time_point<Clock> startTime;
   std::chrono::nanoseconds total;
+
+  // The sum of the time all threads spent in parallel loops run under this
+  // timer, and the wall-clock time of those loops. Their ratio is the
+  // parallelism the phase achieved.
+  std::atomic<int64_t> parallelBusy{0};
+  std::atomic<int64_t> parallelWall{0};
   std::vector<Timer *> children;
   std::string name;
   Timer *parent;
 };
 
+// If true, timers and parallel loops record spans that are later written
+// as a Chrome trace (chrome://tracing or ui.perfetto.dev) by
+// writeTimeTrace(). Drivers set this while reading options, after
+// Timer::root() has started; timers already running are recorded when they
+// stop.
+extern bool timeTraceEnabled;
+
+// Writes all recorded spans in the Chrome trace event format. Must be called
+// from the thread that drove the timers, and not while parallel loops are
+// running.
+void writeTimeTrace(llvm::raw_ostream &os);
+
 } // namespace lld
 
 #endif
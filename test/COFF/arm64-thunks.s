@@ -3,7 +3,7 @@
 // RUN: lld-link -entry:main -subsystem:console %t.obj -out:%t.exe -verbose 2>&1 | FileCheck -check-prefix=VERBOSE %s
 // RUN: llvm-objdump -d %t.exe | FileCheck -check-prefix=DISASM %s
 
-// VERBOSE: Added 1 thunks with margin {{.*}} in 1 passes
+// VERBOSE: Added 1 thunks with margin {{.*}} in 1 passes, checking 2 ranges for 1 relocations
 
     .globl main
     .globl func1
@@ -0,0 +1,32 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo '.globl foo; foo: .section .grp,"aG",@progbits,grp,comdat; .byte 0x22' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t1.o
+# RUN: echo '.section .grp,"aG",@progbits,grp,comdat; .byte 0x33' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t2.o
+# RUN: echo '.section .grp,"aG",@progbits,grp,comdat; .byte 0x44' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t3.o
+# RUN: rm -f %t1.a
+# RUN: llvm-ar rc %t1.a %t1.o
+
+## The first object file given on the command line with a group wins.
+# RUN: ld.lld %t.o %t2.o %t3.o %t1.o -o %t
+# RUN: llvm-objdump -s -j .grp %t | FileCheck --check-prefix=OBJ2 %s
+# RUN: ld.lld %t.o %t3.o %t2.o %t1.o -o %t
+# RUN: llvm-objdump -s -j .grp %t | FileCheck --check-prefix=OBJ3 %s
+
+## An archive member fetched before a later object file is parsed wins over
+## the groups of all later object files.
+# RUN: ld.lld %t.o %t1.a %t2.o %t3.o -o %t
+# RUN: llvm-objdump -s -j .grp %t | FileCheck --check-prefix=ARCHIVE %s
+
+# OBJ2:      Contents of section .grp:
+# OBJ2-NEXT: {{^ [0-9a-f]+ 33 }}
+# OBJ3:      Contents of section .grp:
+# OBJ3-NEXT: {{^ [0-9a-f]+ 44 }}
+# ARCHIVE:      Contents of section .grp:
+# ARCHIVE-NEXT: {{^ [0-9a-f]+ 22 }}
+
+.globl _start
+_start:
+  call foo
@@ -0,0 +1,45 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## Check that input sections are assigned to the first rule that matches
+## them, whether the rule is an exact name, a prefix glob or another glob.
+# RUN: echo "SECTIONS { \
+# RUN:         .a : { *(.foo.b?r) } \
+# RUN:         .b : { *(.foo.*) } \
+# RUN:         .c : { *(.foo) *(.foo.bar .foo.baz) } \
+# RUN:         .d : { *(.f*) } \
+# RUN:       }" > %t.script
+# RUN: ld.lld -o %t -T %t.script %t.o
+# RUN: llvm-readelf -S %t | FileCheck %s
+
+# CHECK:      .a PROGBITS {{[0-9a-f]+}} {{[0-9a-f]+}} 000001
+# CHECK-NEXT: .b PROGBITS {{[0-9a-f]+}} {{[0-9a-f]+}} 000002
+# CHECK-NEXT: .c PROGBITS {{[0-9a-f]+}} {{[0-9a-f]+}} 000001
+# CHECK-NEXT: .d PROGBITS {{[0-9a-f]+}} {{[0-9a-f]+}} 000001
+
+## A section that is released by an ONLY_IF_RW output section can still be
+## claimed by a later rule.
+# RUN: echo "SECTIONS { \
+# RUN:         .a : ONLY_IF_RW { *(.foo) } \
+# RUN:         .b : { *(.fo*) } \
+# RUN:       }" > %t2.script
+# RUN: ld.lld -o %t2 -T %t2.script %t.o
+# RUN: llvm-readelf -S %t2 | FileCheck --check-prefix=CONSTRAINT %s
+
+# CONSTRAINT-NOT: .a
+# CONSTRAINT:     .b PROGBITS {{[0-9a-f]+}} {{[0-9a-f]+}} 000005
+
+.section .foo.bar,"a"
+.byte 0
+
+.section .foo.baz,"a"
+.byte 0
+
+.section .foo.qux,"a"
+.byte 0
+
+.section .foo,"a"
+.byte 0
+
+.section .fx,"a"
+.byte 0
@@ -0,0 +1,37 @@
+; REQUIRES: x86
+
+; RUN: opt -module-hash -module-summary %s -o %t.o
+; RUN: opt -module-hash -module-summary %p/Inputs/cache.ll -o %t2.o
+
+; Populate a cache that will act as the shared one.
+; RUN: rm -Rf %t.shared %t.local && mkdir %t.shared %t.local
+; RUN: ld.lld --verbose --thinlto-cache-dir=%t.shared -o %t3 %t2.o %t.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=MISS %s
+; MISS: ThinLTO cache: 0 hits (0 from shared cache), 2 misses, 0 bytes reused
+
+; Objects found in the shared cache are not copied into the local one.
+; RUN: ld.lld --verbose --thinlto-shared-cache-dir=%t.shared \
+; RUN:   --thinlto-cache-dir=%t.local -o %t3 %t2.o %t.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=SHARED %s
+; SHARED: ThinLTO cache: 2 hits (2 from shared cache), 0 misses
+; RUN: ls %t.local | FileCheck --check-prefix=LOCAL --allow-empty %s
+; LOCAL-NOT: llvmcache-
+
+; The shared cache alone works too, and it is never written to.
+; RUN: rm -Rf %t.empty && mkdir %t.empty
+; RUN: ld.lld --verbose --thinlto-shared-cache-dir=%t.empty -o %t3 %t2.o %t.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=MISS %s
+; RUN: ls %t.empty | count 0
+
+; The statistics are also printed with --time.
+; RUN: ld.lld --time --thinlto-cache-dir=%t.shared -o %t3 %t2.o %t.o \
+; RUN:   | FileCheck --check-prefix=HIT %s
+; HIT: ThinLTO cache: 2 hits (0 from shared cache), 0 misses, {{[1-9][0-9]*}} bytes reused
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @globalfunc() #0 {
+entry:
+  ret void
+}
@@ -0,0 +1,46 @@
+# REQUIRES: x86
+
+## Archive member names are cached in their files on first use. Check that
+## the map file and the cross reference table, which are formatted in
+## parallel, get them right when many sections come from the same member.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t1.o
+# RUN: echo '.globl foo; .section .text.a,"ax"; foo: ret; \
+# RUN:   .section .text.b,"ax"; ret; .section .text.c,"ax"; ret; \
+# RUN:   .section .data.a,"aw"; .quad bar; .section .data.b,"aw"; .quad 0' \
+# RUN:   | llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t2.o
+# RUN: echo '.globl bar; .section .text.d,"ax"; bar: ret; \
+# RUN:   .section .text.e,"ax"; ret; .section .data.c,"aw"; .quad foo' \
+# RUN:   | llvm-mc -filetype=obj -triple=x86_64-pc-linux - -o %t3.o
+# RUN: rm -f %t.a
+# RUN: llvm-ar rc %t.a %t2.o %t3.o
+# RUN: ld.lld --threads %t1.o %t.a -o %t -Map=%t.map --cref | \
+# RUN:   FileCheck --check-prefix=CREF %s
+# RUN: FileCheck %s < %t.map
+
+# CHECK:      .text
+# CHECK:      {{.*}}map-file-archive-threads.s.tmp1.o:(.text)
+# CHECK-NEXT: _start
+# CHECK:      {{.*}}.a(map-file-archive-threads.s.tmp2.o):(.text.a)
+# CHECK-NEXT: foo
+# CHECK-NEXT: {{.*}}.a(map-file-archive-threads.s.tmp2.o):(.text.b)
+# CHECK-NEXT: {{.*}}.a(map-file-archive-threads.s.tmp2.o):(.text.c)
+# CHECK:      {{.*}}.a(map-file-archive-threads.s.tmp3.o):(.text.d)
+# CHECK-NEXT: bar
+# CHECK-NEXT: {{.*}}.a(map-file-archive-threads.s.tmp3.o):(.text.e)
+# CHECK:      .data
+# CHECK:      {{.*}}.a(map-file-archive-threads.s.tmp2.o):(.data.a)
+# CHECK-NEXT: {{.*}}.a(map-file-archive-threads.s.tmp2.o):(.data.b)
+# CHECK:      {{.*}}.a(map-file-archive-threads.s.tmp3.o):(.data.c)
+
+# CREF:      Symbol                                            File
+# CREF-NEXT: _start {{.*}}map-file-archive-threads.s.tmp1.o
+# CREF-NEXT: foo {{.*}}.a(map-file-archive-threads.s.tmp2.o)
+# CREF-NEXT:     {{.*}}map-file-archive-threads.s.tmp1.o
+# CREF-NEXT:     {{.*}}.a(map-file-archive-threads.s.tmp3.o)
+# CREF-NEXT: bar {{.*}}.a(map-file-archive-threads.s.tmp3.o)
+# CREF-NEXT:     {{.*}}.a(map-file-archive-threads.s.tmp2.o)
+
+.globl _start
+_start:
+  call foo
@@ -0,0 +1,51 @@
+// REQUIRES: x86
+// RUN: llvm-mc %s -o %t.o -filetype=obj --triple=x86_64-unknown-linux
+// RUN: rm -rf %t.dir
+// RUN: ld.lld %t.o -o %t --export-dynamic --gc-sections --partition-dir=%t.dir
+// RUN: llvm-readelf -S -l %t.dir/part1 | FileCheck %s
+
+// The partition file should have the same contents as the one extracted by
+// llvm-objcopy.
+// RUN: llvm-objcopy --extract-partition=part1 %t %t.part1
+// RUN: llvm-readelf -l --dyn-symbols -d %t.dir/part1 > %t.lld
+// RUN: llvm-readelf -l --dyn-symbols -d %t.part1 > %t.objcopy
+// RUN: diff %t.lld %t.objcopy
+// RUN: llvm-objdump -s -j .text -j .dynstr %t.dir/part1 | tail -n +3 > %t.lld
+// RUN: llvm-objdump -s -j .text -j .dynstr %t.part1 | tail -n +3 > %t.objcopy
+// RUN: diff %t.lld %t.objcopy
+
+// CHECK:      .dynsym
+// CHECK:      .text
+// CHECK:      .dynamic
+// CHECK:      .shstrtab
+// CHECK-NOT:  part1
+// CHECK:      LOAD
+// CHECK:      DYNAMIC
+
+// RUN: touch %t.file
+// RUN: not ld.lld %t.o -o %t --export-dynamic --gc-sections \
+// RUN:   --partition-dir=%t.file/dir 2>&1 | FileCheck --check-prefix=ERR %s
+// ERR: error: cannot create directory {{.*}}.file/dir
+
+// Partition names are used as file names and may not leave the directory.
+// RUN: echo '.section .llvm_sympart.f2,"",@llvm_sympart; .asciz "../part2";' \
+// RUN:   '.quad f2; .section .text.f2,"ax",@progbits; .globl f2; f2: ret' \
+// RUN:   | llvm-mc -filetype=obj -triple=x86_64-unknown-linux - -o %t2.o
+// RUN: not ld.lld %t.o %t2.o -o %t --export-dynamic --gc-sections \
+// RUN:   --partition-dir=%t.dir 2>&1 | FileCheck --check-prefix=NAME %s
+// NAME: error: {{.*}}2.o: invalid partition name for --partition-dir: ../part2
+// RUN: ld.lld %t.o %t2.o -o %t --export-dynamic --gc-sections
+
+.section .llvm_sympart.f1,"",@llvm_sympart
+.asciz "part1"
+.quad f1
+
+.section .text._start,"ax",@progbits
+.globl _start
+_start:
+call f1
+
+.section .text.f1,"ax",@progbits
+.globl f1
+f1:
+ret
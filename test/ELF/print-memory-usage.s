@@ -0,0 +1,14 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --print-memory-usage | FileCheck %s
+
+# CHECK:      Memory usage:
+# CHECK-NEXT: Symbol auxiliary entries:
+# CHECK-NEXT: Dependent section lists:
+# CHECK:      {{ *[0-9]+}} x {{ *[0-9]+}} bytes = {{ *[0-9]+}} bytes  {{.*}}SymbolUnion
+# CHECK:      Typed arenas total:
+# CHECK-NEXT: Bump allocator:
+
+.globl _start
+_start:
+  nop
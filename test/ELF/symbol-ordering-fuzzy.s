@@ -0,0 +1,70 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+# RUN: echo "c.llvm.111" > %t.order
+# RUN: echo "b" >> %t.order
+# RUN: echo "d.lto_priv.0" >> %t.order
+# RUN: echo "a" >> %t.order
+# RUN: echo "missing" >> %t.order
+
+## By default only exact names match.
+# RUN: ld.lld --symbol-ordering-file %t.order --print-symbol-ordering-stats \
+# RUN:   %t.o -o %t.out 2>&1 | FileCheck %s --check-prefix=EXACT-STATS
+# RUN: llvm-objdump -s -j .foo -j .rodata %t.out | FileCheck %s --check-prefix=EXACT
+
+# EXACT-STATS:      warning: symbol ordering file: no such symbol: c.llvm.111
+# EXACT-STATS-NEXT: warning: symbol ordering file: no such symbol: d.lto_priv.0
+# EXACT-STATS-NEXT: warning: symbol ordering file: no such symbol: missing
+# EXACT-STATS-NEXT: symbol ordering file: 5 symbols, 2 found, 0 found by canonical name, 3 not found
+# EXACT-STATS-NEXT: symbol ordering file: 2 sections ordered, 2 bytes (2 bytes of code, 0 bytes of data)
+
+# EXACT:      Contents of section .foo:
+# EXACT-NEXT:  22113344
+# EXACT:      Contents of section .rodata:
+# EXACT-NEXT:  5566
+
+## With --symbol-ordering-fuzzy, compiler-generated suffixes are ignored
+## on both sides.
+# RUN: ld.lld --symbol-ordering-file %t.order --print-symbol-ordering-stats \
+# RUN:   --symbol-ordering-fuzzy %t.o -o %t.out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=FUZZY-STATS
+# RUN: llvm-objdump -s -j .foo -j .rodata %t.out | FileCheck %s --check-prefix=FUZZY
+
+# FUZZY-STATS:      warning: symbol ordering file: no such symbol: missing
+# FUZZY-STATS-NEXT: symbol ordering file: 5 symbols, 2 found, 2 found by canonical name, 1 not found
+# FUZZY-STATS-NEXT: symbol ordering file: 5 sections ordered, 5 bytes (4 bytes of code, 1 bytes of data)
+
+# FUZZY:      Contents of section .foo:
+# FUZZY-NEXT:  33224411
+# FUZZY:      Contents of section .rodata:
+# FUZZY-NEXT:  6655
+
+.section .foo,"ax",@progbits,unique,1
+.globl a
+a:
+ .byte 0x11
+
+.section .foo,"ax",@progbits,unique,2
+.globl b
+b:
+ .byte 0x22
+
+.section .foo,"ax",@progbits,unique,3
+c.llvm.222:
+ .byte 0x33
+
+.section .foo,"ax",@progbits,unique,4
+d.1:
+ .byte 0x44
+
+.section .rodata,"a",@progbits,unique,1
+.byte 0x55
+
+.section .rodata,"a",@progbits,unique,2
+b.5:
+.byte 0x66
+
+.text
+.globl _start
+_start:
+ ret
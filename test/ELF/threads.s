@@ -0,0 +1,36 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+# RUN: ld.lld --threads=1 %t.o -o %t
+# RUN: ld.lld --threads=3 --icf=all --phase-threads=icf:2 \
+# RUN:   --phase-threads=scan-relocations:1 %t.o -o %t
+
+## --time reports the parallelism achieved by phases with parallel loops.
+# RUN: ld.lld --threads=2 --icf=all --time %t.o -o %t | FileCheck --check-prefix=TIME %s
+# TIME: ICF: {{.*}}x parallel
+
+# RUN: not ld.lld --threads=0 %t.o -o %t 2>&1 | FileCheck --check-prefix=ZERO %s
+# ZERO: error: --threads: expected a positive integer, but got '0'
+
+## The last of --threads, --no-threads and --threads= wins.
+# RUN: ld.lld --threads=0 --no-threads %t.o -o %t
+# RUN: not ld.lld --no-threads --threads=0 %t.o -o %t 2>&1 \
+# RUN:   | FileCheck --check-prefix=ZERO %s
+
+# RUN: not ld.lld --phase-threads=icf %t.o -o %t 2>&1 \
+# RUN:   | FileCheck --check-prefix=SPEC %s
+# SPEC: error: --phase-threads: expected <phase>:<N> with N > 0, but got icf
+
+# RUN: not ld.lld --phase-threads=foo:2 %t.o -o %t 2>&1 \
+# RUN:   | FileCheck --check-prefix=PHASE %s
+# PHASE: error: --phase-threads: unknown phase: foo
+
+.globl _start
+_start:
+  ret
+
+.section .text.a,"ax",@progbits
+  ret
+
+.section .text.b,"ax",@progbits
+  ret
@@ -0,0 +1,35 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## --time prints the phase tree followed by the total.
+# RUN: ld.lld --time --gc-sections %t.o -o %t 2>&1 | FileCheck --check-prefix=TIME %s
+# TIME:      Symbol Resolution:
+# TIME:      GC:
+# TIME:      Code Layout:
+# TIME-NEXT:   Scan Relocations:
+# TIME:      Commit Output File:
+# TIME-NEXT: -------------------------------------------------
+# TIME-NEXT: Total Link Time:
+
+## --time-trace writes a Chrome trace next to the output file.
+# RUN: ld.lld --time-trace %t.o -o %t2
+# RUN: FileCheck --check-prefix=TRACE %s < %t2.time-trace
+
+## --time-trace-file overrides the file name and implies --time-trace.
+# RUN: ld.lld --time-trace-file=%t.json %t.o -o %t3
+# RUN: FileCheck --check-prefix=TRACE %s < %t.json
+# RUN: not ls %t3.time-trace
+
+# TRACE: "traceEvents":[
+# TRACE-DAG: {"args":{"name":"lld"},"name":"thread_name","ph":"M","pid":1,"tid":0}
+# TRACE-DAG: "name":"Total Link Time"
+# TRACE-DAG: "name":"Write Sections"
+# TRACE-DAG: "ph":"X"
+
+# RUN: not ld.lld --time-trace-file=%t.dir/nonexistent/x.json %t.o -o %t4 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: error: cannot open {{.*}}x.json
+
+.globl _start
+_start:
+  ret
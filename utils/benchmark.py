@@ -84,6 +84,20 @@ def run(cmd):
         print(e.output)
         raise e
 
+# Like run, but also returns the resource usage of the command. Only the
+# command and its descendants are counted, so ru_maxrss is the peak RSS of
+# this run alone.
+def runWithUsage(cmd):
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    out = p.stdout.read()
+    p.stdout.close()
+    _, status, usage = os.wait4(p.pid, 0)
+    p.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+    if p.returncode != 0:
+        print(out)
+        raise subprocess.CalledProcessError(p.returncode, cmd, out)
+    return out, usage
+
 def combinePerfRun(acc, d):
     for k,v in d.items():
         a = acc.get(k, [])
@@ -98,8 +112,9 @@ def perf(cmd):
     wrapper_args = [x for x in args.wrapper.split(',') if x]
     for i in range(args.runs):
         os.unlink('t')
-        out = run(wrapper_args + ['perf', 'stat'] + cmd)
+        out, usage = runWithUsage(wrapper_args + ['perf', 'stat'] + cmd)
         r = parsePerf(out)
+        r['max-rss-kb'] = usage.ru_maxrss
         combinePerfRun(ret, r)
     os.unlink('t')
     return ret
@@ -20,6 +20,7 @@
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
 #include "lld/Common/Version.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Object/Wasm.h"
 #include "llvm/Option/Arg.h"
@@ -351,7 +352,20 @@ static void readConfigs(opt::InputArgList &args) {
   config->thinLTOJobs = args::getInteger(args, OPT_thinlto_jobs, -1u);
   errorHandler().verbose = args.hasArg(OPT_verbose);
   LLVM_DEBUG(errorHandler().verbose = true);
-  threadsEnabled = args.hasFlag(OPT_threads, OPT_no_threads, true);
+  // The last of the thread options wins.
+  threadsEnabled = true;
+  threadCount = 0;
+  if (auto *arg =
+          args.getLastArg(OPT_threads, OPT_no_threads, OPT_threads_eq)) {
+    if (arg->getOption().getID() == OPT_threads_eq) {
+      StringRef v = arg->getValue();
+      if (!to_integer(v, threadCount, 10) || threadCount == 0)
+        error("--threads: expected a positive integer, but got '" + v + "'");
+      threadsEnabled = threadCount > 1;
+    } else {
+      threadsEnabled = arg->getOption().getID() == OPT_threads;
+    }
+  }
 
   config->initialMemory = args::getInteger(args, OPT_initial_memory, 0);
   config->globalBase = args::getInteger(args, OPT_global_base, 1024);